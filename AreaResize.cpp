@@ -18,400 +18,593 @@
     OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include <string.h>
+#include <vector>
 #include <windows.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "avisynth.h"
+#include "arearesize.h"
 
-typedef struct {
-    int src_width;
-    int src_height;
-    int target_width;
-    int target_height;
-    int num_h;
-    int den_h;
-    int num_v;
-    int den_v;
-} params_t;
-
-typedef struct {
-    int blue;
-    int green;
-    int red;
-} i_rgb24_t;
-
-typedef struct {
-    BYTE blue;
-    BYTE green;
-    BYTE red;
-} rgb24_t;
-
-typedef struct {
-    int blue;
-    int green;
-    int red;
-    int alpha;
-} i_rgb32_t;
-
-typedef struct {
-    BYTE blue;
-    BYTE green;
-    BYTE red;
-    BYTE alpha;
-} rgb32_t;
-
-static bool ResizeHorizontalPlanar(BYTE* dstp, const BYTE* srcp, int src_pitch, params_t* params)
+static void CheckTarget(const VideoInfo& vi, int target_width, int target_height, const char* name,
+                        IScriptEnvironment* env)
 {
-    int src_height = params->src_height;
-    int target_width = params->target_width;
-    int target_height = params->target_height;
-    int num = params->num_h;
-    int den = params->den_h;
-    int* value = (int *)malloc(sizeof(int) * target_width);
-    if (!value) {
-        return false;
-    }
-
-    for (int y = 0, count_num = 0; y < src_height; y++) {
-        int index_src = 0;
-        for (int index_value = 0; index_value < target_width; index_value++) {
-            value[index_value] = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value] += srcp[index_src];
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src++;
-                }
-            }
-        }
-
-        for (int i = 0; i < target_width; i++) {
-            dstp[i] = (BYTE)(value[i] / den);
-        }
-        srcp += src_pitch;
-        dstp += target_width;
+    if (target_width < 1 || target_height < 1) {
+        env->ThrowError("%s: target width/height must be 1 or higher.", name);
+    }
+    if (vi.IsYUY2()) {
+        env->ThrowError("%s: Unsupported colorspace(YUY2).", name);
+    }
+    if (vi.IsYV411() && target_width & 3) {
+        env->ThrowError("%s: Target width requires mod 4.", name);
+    }
+    if ((vi.IsYV16() || vi.IsYV12()) && target_width & 1) {
+        env->ThrowError("%s: Target width requires mod 2.", name);
+    }
+    if (vi.IsYV12() && target_height & 1) {
+        env->ThrowError("%s: Target height requires mod 2.", name);
+    }
+    if (vi.width < target_width || vi.height < target_height) {
+        env->ThrowError("%s: This filter is only for down scale.", name);
     }
-    free(value);
-    return true;
 }
 
-static bool ResizeVerticalPlanar(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, params_t* params)
+static int64_t Gcd(int64_t x, int64_t y)
 {
-    int src_width = params->target_width;
-    int target_height = params->target_height;
-    int num = params->num_v;
-    int den = params->den_v;
-    int* value = (int *)malloc(sizeof(int) * target_height);
-    if (!value) {
-        return false;
-    }
-
-    for (int x = 0, count_num = 0; x < src_width; x++) {
-        int index_src = 0;
-        for (int index_value = 0; index_value < target_height; index_value++) {
-            value[index_value] = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value] += srcp[index_src];
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src += src_pitch;
-                }
-            }
+    return y == 0 ? x : Gcd(y, x % y);
+}
+
+static int GetFormat(const VideoInfo& vi)
+{
+    return vi.IsRGB32() ? AR_FORMAT_RGB32 :
+           vi.IsRGB24() ? AR_FORMAT_RGB24 :
+           vi.IsY8()    ? AR_FORMAT_GRAY  : AR_FORMAT_YUV;
+}
+
+class AreaResize : public GenericVideoFilter {
+
+    ar_plan_t* plan;
+    ar_scratch_t* scratch;
+    ar_thumbs_t* thumbs;
+    ar_cache_t* cache;
+    ar_temporal_t* temporal;
+    uint64_t source_id;
+    bool passthrough;
+    bool incremental;
+    int num_src_plane;
+    bool flip_src;
+    int prev_n;
+    PVideoFrame prev_src;
+    PVideoFrame prev_dst;
+    std::vector<char> changed_src;  /* changed source rows of one plane */
+    std::vector<char> changed_rows; /* changed output rows, plane after plane */
+
+    bool ResizeChanged(PVideoFrame& src, PVideoFrame& dst, IScriptEnvironment* env);
+    void WriteThumb(int n, PVideoFrame* src, int count);
+    void FetchThumb(int n, IScriptEnvironment* env);
+    void StoreFrame(int n, PVideoFrame& dst);
+    void ResizeTemporal(int n, uint8_t* const* dstp, const int* dst_pitch, IScriptEnvironment* env);
+
+public:
+    AreaResize(PClip _child, int target_width, int target_height, bool incremental,
+               bool premultiplied, int order, bool autotune, const char* thumbs_path,
+               int thumbs_width, int thumbs_height, const char* cache_path, int cache_size,
+               const char* cache_key, int output, int matrix, bool full_range,
+               int fps_num, int fps_den, IScriptEnvironment* env);
+    ~AreaResize();
+    PVideoFrame _stdcall GetFrame(int n, IScriptEnvironment* env);
+};
+
+AreaResize::AreaResize(PClip _child, int target_width, int target_height, bool _incremental,
+                       bool premultiplied, int order, bool autotune, const char* thumbs_path,
+                       int thumbs_width, int thumbs_height, const char* cache_path, int cache_size,
+                       const char* cache_key, int output, int matrix, bool full_range,
+                       int fps_num, int fps_den, IScriptEnvironment* env) : GenericVideoFilter(_child), incremental(_incremental)
+{
+    plan = NULL;
+    scratch = NULL;
+    thumbs = NULL;
+    cache = NULL;
+    temporal = NULL;
+    prev_n = -2;
+
+    ar_config_t config;
+    ar_init_config(&config, vi.width, vi.height, target_width, target_height, GetFormat(vi),
+                   vi.SubsampleH(), vi.SubsampleV());
+    config.premultiplied = premultiplied;
+    config.order = order;
+    if (output) {
+        VideoInfo out = vi;
+        out.pixel_type = output;
+        config.output_format = AR_FORMAT_YUV;
+        config.output_subsample_h = out.SubsampleH();
+        config.output_subsample_v = out.SubsampleV();
+        config.matrix = matrix;
+        config.full_range = full_range;
+    }
+    if (autotune) {
+        ar_autotune(&config, NULL);
+    }
+
+    int ret = ar_create_plan(&config, &plan);
+    if (ret != AR_OK) {
+        env->ThrowError("AreaResize: %s", ar_strerror(ret));
+    }
+    num_src_plane = config.format == AR_FORMAT_YUV ? 3 : 1;
+    /* RGB frames are stored bottom-up, YUV ones top-down. */
+    flip_src = output && vi.IsRGB();
+    scratch = ar_create_scratch(plan);
+    if (!scratch) {
+        ar_free_plan(plan);
+        env->ThrowError("AreaResize: out of memory");
+    }
+
+    /* output rate / source rate, reduced. */
+    int64_t rate[2] = {0, 0};
+    if (fps_num > 0) {
+        rate[0] = (int64_t)fps_num * vi.fps_denominator;
+        rate[1] = (int64_t)fps_den * vi.fps_numerator;
+        int64_t g = Gcd(rate[0], rate[1]);
+        rate[0] /= g;
+        rate[1] /= g;
+        ret = rate[0] > rate[1] ? AR_ERROR_UNSUPPORTED :
+              rate[1] > 0x7fffffff ? AR_ERROR_INVALID :
+              ar_create_temporal(plan, (int)rate[0], (int)rate[1], &temporal);
+        if (ret != AR_OK) {
+            ar_free_scratch(scratch);
+            ar_free_plan(plan);
+            env->ThrowError("AreaResize: cannot reduce the frame rate to %d/%d (%s).", fps_num, fps_den,
+                            ar_strerror(ret));
+        }
+    }
+    int num_frames = temporal ? ar_temporal_frames(temporal, vi.num_frames) : vi.num_frames;
+    if (thumbs_path) {
+        ret = ar_open_thumbs(thumbs_path, num_frames, vi.width, vi.height,
+                             thumbs_width, thumbs_height, &thumbs);
+        if (ret == AR_OK && temporal) {
+            ret = ar_thumbs_temporal(thumbs, (int)rate[0], (int)rate[1]);
         }
-        for (int i = 0; i < target_height; i++) {
-            dstp[i * dst_pitch] = (BYTE)(value[i] / den);
+        if (ret != AR_OK) {
+            ar_close_thumbs(thumbs);
+            ar_free_temporal(temporal);
+            ar_free_scratch(scratch);
+            ar_free_plan(plan);
+            env->ThrowError("AreaResize: cannot open thumbs file %s (%s).", thumbs_path,
+                            ret == AR_ERROR_UNSUPPORTED ? "thumbnail larger than the source" :
+                                                          ar_strerror(ret));
         }
-        srcp++;
-        dstp++;
     }
-    free(value);
-    return true;
+    passthrough = target_width == vi.width && target_height == vi.height && !output && !temporal;
+    if (cache_path && !passthrough) {
+        /* the source is identified by the caller's key and what the host tells about it. */
+        int props[6] = {vi.width, vi.height, vi.num_frames, (int)vi.fps_numerator,
+                        (int)vi.fps_denominator, vi.pixel_type};
+        source_id = ar_hash64(cache_key, strlen(cache_key), ar_hash64(props, sizeof(props), 0));
+        if (temporal) {
+            source_id = ar_hash64(rate, sizeof(rate), source_id);
+        }
+        ret = ar_open_cache(cache_path, plan, (int64_t)cache_size << 20, &cache);
+        if (ret != AR_OK) {
+            ar_free_temporal(temporal);
+            ar_close_thumbs(thumbs);
+            ar_free_scratch(scratch);
+            ar_free_plan(plan);
+            env->ThrowError("AreaResize: cannot open cache file %s.", cache_path);
+        }
+    }
+    if (incremental) {
+        /* the luma is the tallest plane; the flags are reused by every frame. */
+        changed_src.resize(vi.height);
+        size_t rows = 0;
+        for (int i = 0, num_plane = ar_plane_count(plan); i < num_plane; i++) {
+            int width, height;
+            ar_plane_size(plan, i, &width, &height);
+            rows += height;
+        }
+        changed_rows.resize(rows);
+    }
+
+    vi.width = target_width;
+    vi.height = target_height;
+    if (output) {
+        vi.pixel_type = output;
+    }
+    if (temporal) {
+        vi.SetFPS(fps_num, fps_den);
+        vi.num_frames = num_frames;
+    }
 }
 
-static bool ResizeHorizontalRGB32(BYTE* dstp, const BYTE* srcp, int src_pitch, params_t* params)
+AreaResize::~AreaResize()
 {
-    rgb32_t* buff = reinterpret_cast<rgb32_t*>(dstp);
-    int src_height = params->src_height;
-    int target_width = params->target_width;
-    int num = params->num_h;
-    int den = params->den_h;
-    i_rgb32_t* value = (i_rgb32_t*)malloc(sizeof(i_rgb32_t) * target_width);
-    if (!value) {
-        return false;
-    }
-
-    for (int y = 0, count_num = 0; y < src_height; y++) {
-        int index_src = 0;
-        const rgb32_t* rgbp = reinterpret_cast<rgb32_t*>(const_cast<BYTE*>(srcp));
-        for (int index_value = 0; index_value < target_width; index_value++) {
-            value[index_value].blue = 0;
-            value[index_value].green = 0;
-            value[index_value].red = 0;
-            value[index_value].alpha = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value].blue += rgbp[index_src].blue;
-                value[index_value].green += rgbp[index_src].green;
-                value[index_value].red += rgbp[index_src].red;
-                value[index_value].alpha += rgbp[index_src].alpha;
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src++;
-                }
+    ar_close_cache(cache);
+    ar_close_thumbs(thumbs);
+    ar_free_temporal(temporal);
+    ar_free_scratch(scratch);
+    ar_free_plan(plan);
+}
+
+/*
+    incremental mode: every source row is compared with the previous frame
+    once, and an output row is recomputed only if one of the source rows it
+    is computed from changed. the rest is copied from the previous output.
+    returns false when too much has changed to be worth it.
+*/
+bool AreaResize::ResizeChanged(PVideoFrame& src, PVideoFrame& dst, IScriptEnvironment* env)
+{
+    const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+    const int bytes_per_pixel = vi.IsRGB32() ? 4 : vi.IsRGB24() ? 3 : 1;
+    int num_plane = ar_plane_count(plan);
+    int total = 0, dirty = 0;
+    char* changed = &changed_rows[0];
+
+    for (int i = 0; i < num_plane; i++) {
+        const BYTE* srcp = src->GetReadPtr(plane[i]);
+        const BYTE* prevp = prev_src->GetReadPtr(plane[i]);
+        int src_pitch = src->GetPitch(plane[i]);
+        int prev_pitch = prev_src->GetPitch(plane[i]);
+        int row_size = src->GetRowSize(plane[i]);
+        for (int row = 0, rows = src->GetHeight(plane[i]); row < rows; row++) {
+            changed_src[row] = memcmp(srcp + row * src_pitch, prevp + row * prev_pitch, row_size) != 0;
+        }
+
+        int width, height;
+        ar_plane_size(plan, i, &width, &height);
+        for (int y = 0; y < height; y++) {
+            int sx, sy, sw, sh;
+            ar_source_region(plan, i, 0, y, width, 1, &sx, &sy, &sw, &sh);
+            char c = 0;
+            for (int row = sy; row < sy + sh && !c; row++) {
+                c = changed_src[row];
             }
+            changed[y] = c;
+            dirty += c;
         }
-        for (int i = 0; i < target_width; i++) {
-            buff[i].blue = (BYTE)(value[i].blue / den);
-            buff[i].green = (BYTE)(value[i].green / den);
-            buff[i].red = (BYTE)(value[i].red / den);
-            buff[i].alpha = (BYTE)(value[i].alpha / den);
+        changed += height;
+        total += height;
+    }
+
+    bool ret = dirty * 2 <= total;
+    changed = &changed_rows[0];
+    for (int i = 0; i < num_plane && ret; i++) {
+        int width, height;
+        ar_plane_size(plan, i, &width, &height);
+        const BYTE* srcp = src->GetReadPtr(plane[i]);
+        int src_pitch = src->GetPitch(plane[i]);
+        BYTE* dstp = dst->GetWritePtr(plane[i]);
+        int dst_pitch = dst->GetPitch(plane[i]);
+
+        env->BitBlt(dstp, dst_pitch, prev_dst->GetReadPtr(plane[i]), prev_dst->GetPitch(plane[i]),
+                    width * bytes_per_pixel, height);
+
+        /* each run of changed rows is one region. */
+        for (int y = 0; y < height; y++) {
+            if (!changed[y]) {
+                continue;
+            }
+            int end = y + 1;
+            while (end < height && changed[end]) {
+                end++;
+            }
+            ar_resize_region(plan, scratch, i, srcp, src_pitch, dstp, dst_pitch, 0, y, width, end - y);
+            y = end;
         }
-        srcp += src_pitch;
-        buff += target_width;
+        changed += height;
     }
-    free(value);
-    return true;
+    return ret;
 }
 
-static bool ResizeVerticalRGB32(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, params_t* params)
+/*
+    the thumbnail is area averaged from the source luma of output frame n,
+    so it is rounded once like the output and not again from it. a
+    thumbnail already in the file is not written again.
+*/
+void AreaResize::WriteThumb(int n, PVideoFrame* src, int count)
 {
-    int src_width = params->target_width;
-    int const target_height = params->target_height;
-    int num = params->num_v;
-    int den = params->den_v;
-    i_rgb32_t* value = (i_rgb32_t *)malloc(sizeof(i_rgb32_t) * target_height);
-    if (!value) {
-        return false;
-    }
-
-    for (int x = 0, count_num = 0; x < src_width; x++) {
-        int index_src_b = 0;
-        int index_src_g = 1;
-        int index_src_r = 2;
-        int index_src_a = 3;
-        for (int index_value = 0; index_value < target_height; index_value++) {
-            value[index_value].blue = 0;
-            value[index_value].green = 0;
-            value[index_value].red = 0;
-            value[index_value].alpha = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value].blue += srcp[index_src_b];
-                value[index_value].green += srcp[index_src_g];
-                value[index_value].red += srcp[index_src_r];
-                value[index_value].alpha += srcp[index_src_a];
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src_b += src_pitch;
-                    index_src_g += src_pitch;
-                    index_src_r += src_pitch;
-                    index_src_a += src_pitch;
-                }
-            }
-        }
-        for (int i = 0; i < target_height; i++) {
-            int index = i * dst_pitch;
-            dstp[index++] = (BYTE)(value[i].blue / den);
-            dstp[index++] = (BYTE)(value[i].green / den);
-            dstp[index++] = (BYTE)(value[i].red / den);
-            dstp[index] = (BYTE)(value[i].alpha / den);
-        }
-        srcp += 4;
-        dstp += 4;
+    if (!thumbs || n < 0 || n >= vi.num_frames || ar_thumb(thumbs, n)) {
+        return;
+    }
+    if (!temporal) {
+        ar_write_thumb(thumbs, n, src[0]->GetReadPtr(PLANAR_Y), src[0]->GetPitch(PLANAR_Y));
+        return;
     }
-    free(value);
-    return true;
+    std::vector<const uint8_t*> luma(count);
+    for (int f = 0; f < count; f++) {
+        luma[f] = src[f]->GetReadPtr(PLANAR_Y);
+    }
+    ar_write_thumb_temporal(thumbs, n, &luma[0], src[0]->GetPitch(PLANAR_Y));
 }
 
-static bool ResizeHorizontalRGB24(BYTE* dstp, const BYTE* srcp, int src_pitch, params_t* params)
+/* a cached frame has no source, which is fetched only while its thumbnail is missing. */
+void AreaResize::FetchThumb(int n, IScriptEnvironment* env)
 {
-    rgb24_t* buff = reinterpret_cast<rgb24_t*>(dstp);
-    int src_height = params->src_height;
-    int target_width = params->target_width;
-    int num = params->num_h;
-    int den = params->den_h;
-    i_rgb24_t* value = (i_rgb24_t*)malloc(sizeof(i_rgb24_t) * target_width);
-    if (!value) {
-        return false;
-    }
-
-    for (int y = 0, count_num = 0; y < src_height; y++) {
-        int index_src = 0;
-        const rgb24_t* rgbp = reinterpret_cast<rgb24_t*>(const_cast<BYTE*>(srcp));
-        for (int index_value = 0; index_value < target_width; index_value++) {
-            value[index_value].blue = 0;
-            value[index_value].green = 0;
-            value[index_value].red = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value].blue += rgbp[index_src].blue;
-                value[index_value].green += rgbp[index_src].green;
-                value[index_value].red += rgbp[index_src].red;
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src++;
-                }
-            }
-        }
-        for (int i = 0; i < target_width; i++) {
-            buff[i].blue = (BYTE)(value[i].blue / den);
-            buff[i].green = (BYTE)(value[i].green / den);
-            buff[i].red = (BYTE)(value[i].red / den);
+    if (!thumbs || n < 0 || n >= vi.num_frames || ar_thumb(thumbs, n)) {
+        return;
+    }
+    int first = n, count = 1;
+    if (temporal) {
+        ar_temporal_sources(temporal, n, &first, &count);
+    }
+    std::vector<PVideoFrame> src(count);
+    for (int f = 0; f < count; f++) {
+        src[f] = child->GetFrame(first + f, env);
+    }
+    WriteThumb(n, &src[0], count);
+}
+
+/* keeps a freshly resized frame in the cache. */
+void AreaResize::StoreFrame(int n, PVideoFrame& dst)
+{
+    if (cache) {
+        const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+        const uint8_t* dstp[AR_MAX_PLANES];
+        int dst_pitch[AR_MAX_PLANES];
+        for (int i = 0, num_plane = ar_plane_count(plan); i < num_plane; i++) {
+            dstp[i] = dst->GetReadPtr(plane[i]);
+            dst_pitch[i] = dst->GetPitch(plane[i]);
         }
-        srcp += src_pitch;
-        buff += target_width;
+        ar_cache_put(cache, source_id, n, dstp, dst_pitch, NULL, 0);
     }
-    free(value);
-    return true;
 }
 
-static bool ResizeVerticalRGB24(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, params_t* params)
+/*
+    frame rate reduction: all the source frames output frame n overlaps
+    are fetched first and then averaged with their overlap as weight.
+*/
+void AreaResize::ResizeTemporal(int n, uint8_t* const* dstp, const int* dst_pitch, IScriptEnvironment* env)
 {
-    int src_width = params->target_width;
-    int target_height = params->target_height;
-    int num = params->num_v;
-    int den = params->den_v;
-    i_rgb24_t* value = (i_rgb24_t *)malloc(sizeof(i_rgb24_t) * target_height);
-    if (!value) {
-        return false;
-    }
-
-    for (int x = 0, count_num = 0; x < src_width; x++) {
-        int index_src_b = 0;
-        int index_src_g = 1;
-        int index_src_r = 2;
-        for (int index_value = 0; index_value < target_height; index_value++) {
-            value[index_value].blue = 0;
-            value[index_value].green = 0;
-            value[index_value].red = 0;
-            for (int count_den = 0; count_den < den; count_den++) {
-                value[index_value].blue += srcp[index_src_b];
-                value[index_value].green += srcp[index_src_g];
-                value[index_value].red += srcp[index_src_r];
-                if (++count_num == num) {
-                    count_num = 0;
-                    index_src_b += src_pitch;
-                    index_src_g += src_pitch;
-                    index_src_r += src_pitch;
-                }
-            }
+    const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+    int first, count;
+    ar_temporal_sources(temporal, n, &first, &count);
+
+    std::vector<PVideoFrame> src(count);
+    std::vector<const uint8_t*> srcp(count * num_src_plane);
+    int src_pitch[AR_MAX_PLANES];
+    for (int f = 0; f < count; f++) {
+        src[f] = child->GetFrame(first + f, env);
+        for (int i = 0; i < num_src_plane; i++) {
+            srcp[f * num_src_plane + i] = src[f]->GetReadPtr(plane[i]);
+            src_pitch[i] = src[f]->GetPitch(plane[i]);
         }
-        for (int i = 0; i < target_height; i++) {
-            int index = i * dst_pitch;
-            dstp[index++] = (BYTE)(value[i].blue / den);
-            dstp[index++] = (BYTE)(value[i].green / den);
-            dstp[index] = (BYTE)(value[i].red / den);
+        if (flip_src) {
+            srcp[f * num_src_plane] += (src[f]->GetHeight() - 1) * src_pitch[0];
         }
-        srcp += 3;
-        dstp += 3;
     }
-    free(value);
-    return true;
+    if (flip_src) {
+        src_pitch[0] = -src_pitch[0];
+    }
+
+    int ret = ar_resize_temporal(temporal, n, &srcp[0], src_pitch, dstp, dst_pitch);
+    if (ret != AR_OK) {
+        env->ThrowError("AreaResize: %s", ar_strerror(ret));
+    }
+    WriteThumb(n, &src[0], count);
 }
 
-static int gcd(int x, int y)
+PVideoFrame AreaResize::GetFrame(int n, IScriptEnvironment* env)
 {
-    int m = x % y;
-    return m == 0 ? y : gcd(y, m);
-}
+    const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+    int num_plane = ar_plane_count(plan);
 
-class AreaResize : public GenericVideoFilter {
+    if (passthrough) {
+        PVideoFrame src = child->GetFrame(n, env);
+        WriteThumb(n, &src, 1);
+        return src;
+    }
+
+    PVideoFrame dst = env->NewVideoFrame(vi);
+    uint8_t* dstp[AR_MAX_PLANES];
+    int dst_pitch[AR_MAX_PLANES];
+    for (int i = 0; i < num_plane; i++) {
+        dstp[i] = dst->GetWritePtr(plane[i]);
+        dst_pitch[i] = dst->GetPitch(plane[i]);
+    }
+
+    /* a cached frame does not even fetch the source. */
+    if (cache && ar_cache_get(cache, source_id, n, dstp, dst_pitch, NULL, NULL)) {
+        FetchThumb(n, env);
+        return dst;
+    }
+
+    if (temporal) {
+        ResizeTemporal(n, dstp, dst_pitch, env);
+        StoreFrame(n, dst);
+        return dst;
+    }
+
+    PVideoFrame src = child->GetFrame(n, env);
+
+    if (incremental && n == prev_n + 1 && ResizeChanged(src, dst, env)) {
+        prev_n = n;
+        prev_src = src;
+        prev_dst = dst;
+        StoreFrame(n, dst);
+        WriteThumb(n, &src, 1);
+        return dst;
+    }
+
+    const uint8_t* srcp[AR_MAX_PLANES];
+    int src_pitch[AR_MAX_PLANES];
+    for (int i = 0; i < num_src_plane; i++) {
+        srcp[i] = src->GetReadPtr(plane[i]);
+        src_pitch[i] = src->GetPitch(plane[i]);
+    }
+    if (flip_src) {
+        srcp[0] += (src->GetHeight() - 1) * src_pitch[0];
+        src_pitch[0] = -src_pitch[0];
+    }
 
-    static const int num_plane = 3;
-    params_t params[num_plane];
+    ar_resize(plan, scratch, srcp, src_pitch, dstp, dst_pitch);
 
-    BYTE* buff;
+    if (incremental) {
+        prev_n = n;
+        prev_src = src;
+        prev_dst = dst;
+    }
+    StoreFrame(n, dst);
+    WriteThumb(n, &src, 1);
+    return dst;
+}
+
+/*
+    contact sheet: output frame k holds cols * rows tiles, tile t being
+    source frame (k * cols * rows + t) * step downscaled to tile_w x
+    tile_h. every tile is resized straight into its place in the output
+    frame with the one plan. the source frames are fetched first (GetFrame
+    of the child is not reentrant), then the tiles are resized in parallel
+    when built with OpenMP, one scratch per thread. tiles past the end of
+    the clip are black.
+*/
+class AreaResizeMosaic : public GenericVideoFilter {
 
-    bool (*ResizeHorizontal)(BYTE*, const BYTE*, int, params_t*);
-    bool (*ResizeVertical)(BYTE*, int, const BYTE*, int, params_t*);
+    ar_plan_t* plan;
+    ar_scratch_t** scratch;
+    int num_scratch;
+    int cols;
+    int rows;
+    int step;
+    int src_frames;
+    int bytes_per_pixel;
+
+    void FillBlack(PVideoFrame& dst, int tile);
+    int PlaneOffset(int plane, int tile, int pitch);
 
 public:
-    AreaResize(PClip _child, int target_width, int target_height, IScriptEnvironment* env);
-    ~AreaResize();
+    AreaResizeMosaic(PClip _child, int tile_w, int tile_h, int cols, int rows, int step,
+                     IScriptEnvironment* env);
+    ~AreaResizeMosaic();
     PVideoFrame _stdcall GetFrame(int n, IScriptEnvironment* env);
 };
 
-AreaResize::AreaResize(PClip _child, int target_width, int target_height, IScriptEnvironment* env) : GenericVideoFilter(_child)
+AreaResizeMosaic::AreaResizeMosaic(PClip _child, int tile_w, int tile_h, int _cols, int _rows,
+                                   int _step, IScriptEnvironment* env) :
+    GenericVideoFilter(_child), cols(_cols), rows(_rows), step(_step)
 {
-    buff = NULL;
-    if (target_width != vi.width) {
-        buff = (BYTE *)malloc(target_width * vi.height * (vi.IsRGB32() ? 4: vi.IsRGB24() ? 3 : 1));
-        if (!buff) {
-            env->ThrowError("AreaResize: out of memory");
+    plan = NULL;
+    scratch = NULL;
+    num_scratch = 1;
+#ifdef _OPENMP
+    num_scratch = omp_get_max_threads();
+#endif
+
+    ar_config_t config;
+    ar_init_config(&config, vi.width, vi.height, tile_w, tile_h, GetFormat(vi),
+                   vi.SubsampleH(), vi.SubsampleV());
+    int ret = ar_create_plan(&config, &plan);
+    if (ret != AR_OK) {
+        env->ThrowError("AreaResizeMosaic: %s", ar_strerror(ret));
+    }
+    scratch = new ar_scratch_t*[num_scratch];
+    for (int i = 0; i < num_scratch; i++) {
+        scratch[i] = ar_create_scratch(plan);
+        if (!scratch[i]) {
+            while (i--) {
+                ar_free_scratch(scratch[i]);
+            }
+            delete [] scratch;
+            ar_free_plan(plan);
+            env->ThrowError("AreaResizeMosaic: out of memory");
         }
     }
 
-    for (int i = 0; i < num_plane; i++) {
-        params[i].src_width     = i ? vi.width / vi.SubsampleH() : vi.width;
-        params[i].src_height    = i ? vi.height / vi.SubsampleV() : vi.height;
-        params[i].target_width  = i ? target_width / vi.SubsampleH() : target_width;
-        params[i].target_height = i ? target_height / vi.SubsampleV() : target_height;
+    bytes_per_pixel = vi.IsRGB32() ? 4 : vi.IsRGB24() ? 3 : 1;
+    src_frames = vi.num_frames;
+    int per_frame = cols * rows * step;
+    vi.width = tile_w * cols;
+    vi.height = tile_h * rows;
+    vi.num_frames = (src_frames + per_frame - 1) / per_frame;
+    /* reduce before multiplying; if the denominator still does not fit, drop precision. */
+    int64_t fps_num = vi.fps_numerator, fps_den = vi.fps_denominator;
+    int64_t g = Gcd(fps_num, per_frame);
+    fps_num /= g;
+    fps_den *= per_frame / g;
+    while (fps_den > 0xffffffff) {
+        fps_num = (fps_num + 1) >> 1;
+        fps_den >>= 1;
     }
+    vi.SetFPS((unsigned)fps_num, (unsigned)fps_den);
+}
 
-    vi.width = target_width;
-    vi.height = target_height;
-
-    for (int i = 0; i < num_plane; i++) {
-        int gcd_h = gcd(params[i].src_width, params[i].target_width);
-        int gcd_v = gcd(params[i].src_height, params[i].target_height);
-        params[i].num_h = params[i].target_width / gcd_h;
-        params[i].den_h = params[i].src_width / gcd_h;
-        params[i].num_v = params[i].target_height / gcd_v;
-        params[i].den_v = params[i].src_height / gcd_v;
-    }
-
-    if (vi.IsRGB32()) {
-        ResizeHorizontal = ResizeHorizontalRGB32;
-        ResizeVertical = ResizeVerticalRGB32;
-    } else if (vi.IsRGB24()) {
-        ResizeHorizontal = ResizeHorizontalRGB24;
-        ResizeVertical = ResizeVerticalRGB24;
-    } else {
-        ResizeHorizontal = ResizeHorizontalPlanar;
-        ResizeVertical = ResizeVerticalPlanar;
+AreaResizeMosaic::~AreaResizeMosaic()
+{
+    for (int i = 0; i < num_scratch; i++) {
+        ar_free_scratch(scratch[i]);
     }
+    delete [] scratch;
+    ar_free_plan(plan);
 }
 
-AreaResize::~AreaResize()
+/* RGB frames are stored bottom-up, so the first tile row is the last in memory. */
+int AreaResizeMosaic::PlaneOffset(int plane, int tile, int pitch)
 {
-    if (buff) {
-        free(buff);
-    }
+    int width, height;
+    ar_plane_size(plan, plane, &width, &height);
+    int col = tile % cols;
+    int row = vi.IsRGB() ? rows - 1 - tile / cols : tile / cols;
+    return row * height * pitch + col * width * bytes_per_pixel;
 }
 
-PVideoFrame AreaResize::GetFrame(int n, IScriptEnvironment* env)
+void AreaResizeMosaic::FillBlack(PVideoFrame& dst, int tile)
 {
-    PVideoFrame src = child->GetFrame(n, env);
-    if (params[0].src_width == params[0].target_width &&
-        params[0].src_height == params[0].target_height) {
-        return src;
+    const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+    for (int i = 0, num_plane = ar_plane_count(plan); i < num_plane; i++) {
+        int width, height;
+        int pitch = dst->GetPitch(plane[i]);
+        ar_plane_size(plan, i, &width, &height);
+        BYTE* dstp = dst->GetWritePtr(plane[i]) + PlaneOffset(i, tile, pitch);
+        int value = vi.IsRGB() ? 0 : i ? 128 : 16;
+        for (int y = 0; y < height; y++) {
+            memset(dstp, value, width * bytes_per_pixel);
+            dstp += pitch;
+        }
     }
+}
 
+PVideoFrame AreaResizeMosaic::GetFrame(int n, IScriptEnvironment* env)
+{
+    const int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
+    int num_plane = ar_plane_count(plan);
+    int tiles = cols * rows;
     PVideoFrame dst = env->NewVideoFrame(vi);
+    std::vector<PVideoFrame> src(tiles);
 
-    int plane[] = {PLANAR_Y, PLANAR_U, PLANAR_V};
-    for (int i = 0, time = vi.IsInterleaved() ? 1 : 3; i < time; i++) {
-        const BYTE* srcp = src->GetReadPtr(plane[i]);
-        int src_pitch = src->GetPitch(plane[i]);
-
-        const BYTE* resized_h;
-        if (params[i].src_width == params[i].target_width) {
-            resized_h = srcp;
-        } else {
-            if (!ResizeHorizontal(buff, srcp, src_pitch, &params[i])) {
-                return dst;
-            }
-            resized_h = buff;
-            src_pitch = dst->GetRowSize(plane[i]);
-        }
-
-        BYTE* dstp = dst->GetWritePtr(plane[i]);
-        int dst_pitch = dst->GetPitch(plane[i]);
-        if (params[i].src_height == params[i].target_height) {
-            env->BitBlt(dstp, dst_pitch, resized_h, src_pitch, dst->GetRowSize(plane[i]), dst->GetHeight(plane[i]));
+    int count = 0;
+    for (int t = 0; t < tiles; t++) {
+        int frame = (n * tiles + t) * step;
+        if (frame >= src_frames) {
+            FillBlack(dst, t);
             continue;
         }
+        src[t] = child->GetFrame(frame, env);
+        count = t + 1;
+    }
 
-        if (!ResizeVertical(dstp, dst_pitch, resized_h, src_pitch, &params[i])) {
-            return dst;
-        }
+    BYTE* dstp[AR_MAX_PLANES];
+    int dst_pitch[AR_MAX_PLANES];
+    for (int i = 0; i < num_plane; i++) {
+        dstp[i] = dst->GetWritePtr(plane[i]);
+        dst_pitch[i] = dst->GetPitch(plane[i]);
     }
 
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_scratch) schedule(dynamic)
+#endif
+    for (int t = 0; t < count; t++) {
+        ar_scratch_t* s = scratch[0];
+#ifdef _OPENMP
+        s = scratch[omp_get_thread_num()];
+#endif
+        const uint8_t* sp[AR_MAX_PLANES];
+        uint8_t* dp[AR_MAX_PLANES];
+        int src_pitch[AR_MAX_PLANES];
+        for (int i = 0; i < num_plane; i++) {
+            sp[i] = src[t]->GetReadPtr(plane[i]);
+            src_pitch[i] = src[t]->GetPitch(plane[i]);
+            dp[i] = dstp[i] + PlaneOffset(i, t, dst_pitch[i]);
+        }
+        ar_resize(plan, s, sp, src_pitch, dp, dst_pitch);
+    }
     return dst;
 }
 
@@ -420,33 +613,115 @@ AVSValue __cdecl CreateAreaResize(AVSValue args, void* user_data, IScriptEnviron
     PClip clip = args[0].AsClip();
     int target_width = args[1].AsInt();
     int target_height = args[2].AsInt();
+    bool incremental = args[3].AsBool(false);
+    bool premultiplied = args[4].AsBool(false);
+    int order = args[5].AsInt(AR_ORDER_AUTO);
+    bool autotune = args[6].AsBool(false);
+    const char* thumbs = args[7].AsString(NULL);
+    int thumbs_width = args[8].AsInt(64);
+    int thumbs_height = args[9].AsInt(36);
+    const char* cache = args[10].AsString(NULL);
+    int cache_size = args[11].AsInt(256);
+    const char* cache_key = args[12].AsString(NULL);
+    const char* output_name = args[13].AsString(NULL);
+    const char* matrix_name = args[14].AsString("Rec601");
+    int fps_num = args[15].AsInt(0);
+    int fps_den = args[16].AsInt(1);
 
-    if (target_width < 1 || target_height < 1) {
-        env->ThrowError("AreaResize: target width/height must be 1 or higher.");
+    const VideoInfo& vi = clip->GetVideoInfo();
+    CheckTarget(vi, target_width, target_height, "AreaResize", env);
+
+    int output = 0;
+    if (output_name) {
+        output = !_stricmp(output_name, "YV12") ? VideoInfo::CS_YV12 :
+                 !_stricmp(output_name, "YV16") ? VideoInfo::CS_YV16 :
+                 !_stricmp(output_name, "YV24") ? VideoInfo::CS_YV24 : -1;
+        if (output < 0) {
+            env->ThrowError("AreaResize: output must be \"YV12\", \"YV16\" or \"YV24\".");
+        }
+        if (vi.IsRGB24() || vi.IsRGB32()) {
+            if (premultiplied || incremental) {
+                env->ThrowError("AreaResize: output from RGB cannot be used with premultiplied or incremental.");
+            }
+        } else if (!vi.IsPlanar() || vi.IsY8()) {
+            env->ThrowError("AreaResize: output requires RGB24, RGB32 or planar YUV.");
+        }
+        if ((output != VideoInfo::CS_YV24 && target_width & 1) ||
+            (output == VideoInfo::CS_YV12 && target_height & 1)) {
+            env->ThrowError("AreaResize: target width/height does not fit %s.", output_name);
+        }
+        if (output == vi.pixel_type) {
+            output = 0;
+        }
+    }
+    /* the same names as the matrix argument of ConvertToYV12(). */
+    int matrix = AR_MATRIX_BT601;
+    bool full_range = !_strnicmp(matrix_name, "PC.", 3);
+    if (!_stricmp(matrix_name, "Rec709") || !_stricmp(matrix_name, "PC.709")) {
+        matrix = AR_MATRIX_BT709;
+    } else if (_stricmp(matrix_name, "Rec601") && _stricmp(matrix_name, "PC.601")) {
+        env->ThrowError("AreaResize: matrix must be \"Rec601\", \"Rec709\", \"PC.601\" or \"PC.709\".");
+    }
+    if (premultiplied && !vi.IsRGB32()) {
+        env->ThrowError("AreaResize: premultiplied requires RGB32.");
+    }
+    if (order < AR_ORDER_AUTO || order > AR_ORDER_VERTICAL_FIRST) {
+        env->ThrowError("AreaResize: order must be 0(auto), 1(horizontal first) or 2(vertical first).");
     }
 
-    const VideoInfo& vi = clip->GetVideoInfo();
-    if (vi.IsYUY2()) {
-        env->ThrowError("AreaResize: Unsupported colorspace(YUY2).");
+    if (thumbs && (vi.IsRGB() || !vi.IsPlanar())) {
+        env->ThrowError("AreaResize: thumbs requires a planar YUV or Y8 clip.");
     }
-    if (vi.IsYV411() && target_width & 3) {
-        env->ThrowError("AreaResize: Target width requires mod 4.");
+    if (thumbs && (thumbs_width < 1 || thumbs_height < 1)) {
+        env->ThrowError("AreaResize: thumbs_width/thumbs_height must be 1 or higher.");
     }
-    if ((vi.IsYV16() || vi.IsYV12()) && target_width & 1) {
-        env->ThrowError("AreaResize: Target width requires mod 2.");
+    if (cache && cache_size < 1) {
+        env->ThrowError("AreaResize: cache_size must be 1 or higher.");
     }
-    if (vi.IsYV12() && target_height & 1) {
-        env->ThrowError("AreaResize: Target height requires mod 2.");
+    if (cache && (!cache_key || !*cache_key)) {
+        env->ThrowError("AreaResize: cache requires a cache_key that names the source.");
     }
-    if (vi.width < target_width || vi.height < target_height) {
-        env->ThrowError("AreaResize: This filter is only for down scale.");
+    if (args[15].Defined() || args[16].Defined()) {
+        if (fps_num < 1 || fps_den < 1) {
+            env->ThrowError("AreaResize: fps_num/fps_den must be 1 or higher.");
+        }
+        if (incremental || premultiplied || (output && (vi.IsRGB24() || vi.IsRGB32()))) {
+            env->ThrowError("AreaResize: fps_num cannot be used with incremental, premultiplied or output from RGB.");
+        }
+    }
+
+    return new AreaResize(clip, target_width, target_height, incremental, premultiplied, order, autotune,
+                          thumbs, thumbs_width, thumbs_height, cache, cache_size, cache_key,
+                          output, matrix, full_range, fps_num, fps_den, env);
+}
+
+AVSValue __cdecl CreateAreaResizeMosaic(AVSValue args, void* user_data, IScriptEnvironment* env)
+{
+    PClip clip = args[0].AsClip();
+    int tile_w = args[1].AsInt();
+    int tile_h = args[2].AsInt();
+    int cols = args[3].AsInt();
+    int rows = args[4].AsInt();
+    int step = args[5].AsInt(1);
+
+    const VideoInfo& vi = clip->GetVideoInfo();
+    CheckTarget(vi, tile_w, tile_h, "AreaResizeMosaic", env);
+    if (cols < 1 || rows < 1) {
+        env->ThrowError("AreaResizeMosaic: cols/rows must be 1 or higher.");
+    }
+    if (step < 1) {
+        env->ThrowError("AreaResizeMosaic: step must be 1 or higher.");
+    }
+    if (!vi.HasVideo() || vi.num_frames < 1) {
+        env->ThrowError("AreaResizeMosaic: clip has no frames.");
     }
 
-    return new AreaResize(clip, target_width, target_height, env);
+    return new AreaResizeMosaic(clip, tile_w, tile_h, cols, rows, step, env);
 }
 
 extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit2(IScriptEnvironment* env)
 {
-    env->AddFunction("AreaResize", "cii", CreateAreaResize, 0);
-    return "AreaResize for AviSynth 0.1.0";
+    env->AddFunction("AreaResize", "cii[incremental]b[premultiplied]b[order]i[autotune]b[thumbs]s[thumbs_width]i[thumbs_height]i[cache]s[cache_size]i[cache_key]s[output]s[matrix]s[fps_num]i[fps_den]i", CreateAreaResize, 0);
+    env->AddFunction("AreaResizeMosaic", "ciiii[step]i", CreateAreaResizeMosaic, 0);
+    return "AreaResize for AviSynth 0.2.0";
 }
@@ -0,0 +1,1851 @@
+/*
+    arearesize - area-average downscaler library
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+#include "arearesize.h"
+#include "kernel.h"
+#include "mapped_file.h"
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+/*
+    how one plane is resized: 'first' writes the intermediate in buff and
+    'second' reads it. first is NULL when only one pass is needed, both are
+    NULL when the plane is copied. premultiplied planes run only 'second',
+    which resizes both axes at absolute source positions.
+*/
+typedef struct {
+    bool vertical_first;
+    pass_t first;
+    pass_t second;
+    int buff_pitch;
+    int buff_bytes_per_pixel;
+} pipeline_t;
+
+struct ar_plan {
+    ar_config_t config;
+    int num_plane;
+    int bytes_per_pixel;
+    params_t params[AR_MAX_PLANES];
+    pipeline_t pipeline[AR_MAX_PLANES];
+    size_t buff_size;
+    size_t value_size;  /* in bytes */
+    size_t sums_size;   /* 32bit horizontal sums of a whole plane, see scratch_sums() */
+    /* what is written; differs from the above only when converting. */
+    int out_plane;
+    int out_bytes_per_pixel[AR_MAX_PLANES];
+    int out_width[AR_MAX_PLANES];
+    int out_height[AR_MAX_PLANES];
+    bool to_yuv;
+    float coef[12];     /* Y, U, V rows of {r, g, b, offset} */
+    int semi_planar_depth;  /* 8, 10 or 16 for NV12/P010/P016, else 0 */
+};
+
+struct ar_scratch {
+    BYTE* buff;
+    void* value;
+    size_t buff_size;
+    size_t value_size;
+    BYTE* sums;
+    size_t sums_size;
+};
+
+void ar_init_config(ar_config_t* config, int src_width, int src_height,
+                    int target_width, int target_height, int format,
+                    int subsample_h, int subsample_v)
+{
+    memset(config, 0, sizeof(ar_config_t));
+    config->src_width = src_width;
+    config->src_height = src_height;
+    config->target_width = target_width;
+    config->target_height = target_height;
+    config->format = format;
+    config->subsample_h = format == AR_FORMAT_YUV ? subsample_h : 1;
+    config->subsample_v = format == AR_FORMAT_YUV ? subsample_v : 1;
+    config->sample_type = AR_SAMPLE_U8;
+    config->order = AR_ORDER_AUTO;
+    config->output_format = format;
+    config->output_subsample_h = config->subsample_h;
+    config->output_subsample_v = config->subsample_v;
+    config->matrix = AR_MATRIX_BT601;
+}
+
+static bool valid_subsample(int sub)
+{
+    return sub == 1 || sub == 2 || sub == 4;
+}
+
+static bool is_semi_planar(int format)
+{
+    return format == AR_FORMAT_NV12 || format == AR_FORMAT_P010 || format == AR_FORMAT_P016;
+}
+
+/* plans that write other planes than they read have no region, stream or tensor output. */
+static bool converts(const ar_plan_t* plan)
+{
+    return plan->to_yuv || plan->semi_planar_depth;
+}
+
+static int check_config(const ar_config_t* config)
+{
+    if (config->format < AR_FORMAT_GRAY || config->format > AR_FORMAT_RGB32) {
+        return AR_ERROR_INVALID;
+    }
+    if (config->src_width < 1 || config->src_height < 1 ||
+        config->target_width < 1 || config->target_height < 1) {
+        return AR_ERROR_INVALID;
+    }
+    if (config->sample_type != AR_SAMPLE_U8 && config->sample_type != AR_SAMPLE_FLOAT) {
+        return AR_ERROR_INVALID;
+    }
+    if (config->sample_type == AR_SAMPLE_FLOAT &&
+        (config->format == AR_FORMAT_RGB24 || config->format == AR_FORMAT_RGB32)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    if (config->premultiplied && config->format != AR_FORMAT_RGB32) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    if (config->alpha && (config->format == AR_FORMAT_RGB24 || config->format == AR_FORMAT_RGB32 ||
+                          is_semi_planar(config->output_format))) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    if (config->order < AR_ORDER_AUTO || config->order > AR_ORDER_VERTICAL_FIRST) {
+        return AR_ERROR_INVALID;
+    }
+    int sub_h = config->subsample_h;
+    int sub_v = config->subsample_v;
+    int out_h = config->output_subsample_h;
+    int out_v = config->output_subsample_v;
+    if (!valid_subsample(sub_h) || !valid_subsample(sub_v) ||
+        !valid_subsample(out_h) || !valid_subsample(out_v)) {
+        return AR_ERROR_INVALID;
+    }
+    if (config->src_width % sub_h || config->src_height % sub_v ||
+        config->target_width % out_h || config->target_height % out_v) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    if (is_semi_planar(config->output_format)) {
+        if (config->format != AR_FORMAT_YUV || config->sample_type != AR_SAMPLE_U8) {
+            return AR_ERROR_UNSUPPORTED;
+        }
+    } else if (config->output_format != config->format) {
+        if (config->output_format != AR_FORMAT_YUV ||
+            (config->format != AR_FORMAT_RGB24 && config->format != AR_FORMAT_RGB32) ||
+            config->sample_type != AR_SAMPLE_U8 || config->premultiplied) {
+            return AR_ERROR_UNSUPPORTED;
+        }
+        if (config->matrix < AR_MATRIX_BT601 || config->matrix > AR_MATRIX_BT709) {
+            return AR_ERROR_INVALID;
+        }
+    }
+    bool rgb_to_yuv = config->format != AR_FORMAT_YUV && config->output_format == AR_FORMAT_YUV;
+    if (!rgb_to_yuv && (out_h != sub_h || out_v != sub_v)) {
+        /* chroma is resampled from one subsampling to the other, downwards only. */
+        if (config->format != AR_FORMAT_YUV ||
+            config->target_width / out_h > config->src_width / sub_h ||
+            config->target_height / out_v > config->src_height / sub_v) {
+            return AR_ERROR_UNSUPPORTED;
+        }
+    }
+    if (config->src_width < config->target_width || config->src_height < config->target_height) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    return AR_OK;
+}
+
+/*
+    rough cost of both orders: the multiply-adds of the two passes plus
+    writing and reading back the intermediate. the source is read once
+    either way. a horizontal multiply-add gathers from start[x]; its cost
+    in vertical ones was measured by timing both orders over 15 geometries
+    from 720x480 -> 704x240 to 3840x2160 -> 160x90 with order forced:
+    for gray, YUV and RGB24 planes any weight from 1.25 to 3 came within
+    a few percent of always taking the faster order, below that it lost
+    10-18%. BGRA, whose 4 channels gather as one pixel, did best below 1.
+*/
+#define TAP_COST_H 2.0
+#define TAP_COST_H_BGRA 0.75
+
+static bool vertical_first_is_cheaper(const params_t* params, int channels)
+{
+    double src_w = params->src_width, src_h = params->src_height;
+    double dst_w = params->target_width, dst_h = params->target_height;
+    double taps_h = params->axis_h.taps * (channels == 4 ? TAP_COST_H_BGRA : TAP_COST_H);
+    double taps_v = params->axis_v.taps;
+    double h_first = src_h * dst_w * (taps_h + 2) + dst_h * dst_w * taps_v;
+    double v_first = dst_h * src_w * (taps_v + 2) + dst_h * dst_w * taps_h;
+    return v_first < h_first;
+}
+
+static void init_pipeline(pipeline_t* pl, const ar_config_t* config, const params_t* params, int channels)
+{
+    bool resize_h = params->src_width != params->target_width;
+    bool resize_v = params->src_height != params->target_height;
+    memset(pl, 0, sizeof(pipeline_t));
+    if (!resize_h && !resize_v) {
+        return;
+    }
+
+    if (config->sample_type == AR_SAMPLE_FLOAT) {
+        pl->first = resize_h && resize_v ? GetFloatPass(true) : NULL;
+        pl->second = GetFloatPass(!resize_v);
+        pl->buff_bytes_per_pixel = sizeof(float);
+    } else if (config->premultiplied) {
+        pl->second = GetPremultipliedPass(PremultipliedSumType(params->den_h),
+                                          PremultipliedSumType((double)params->den_h * params->den_v));
+    } else if (resize_h && resize_v) {
+        pl->vertical_first = config->order == AR_ORDER_AUTO ? vertical_first_is_cheaper(params, channels)
+                                                            : config->order == AR_ORDER_VERTICAL_FIRST;
+        int sum = SumType(pl->vertical_first ? params->den_v : params->den_h);
+        int acc = SumType((double)params->den_h * params->den_v);
+        pl->first = GetPass(channels, !pl->vertical_first, PASS_FIRST, sum, sum);
+        pl->second = GetPass(channels, pl->vertical_first, PASS_SECOND, sum, acc);
+        pl->buff_bytes_per_pixel = channels * (sum == SUM_16 ? sizeof(uint16_t) : sizeof(uint32_t));
+    } else {
+        int acc = SumType((double)params->den_h * params->den_v);
+        pl->second = GetPass(channels, resize_h, PASS_ONLY, acc, acc);
+    }
+    pl->buff_pitch = (pl->vertical_first ? params->src_width : params->target_width) *
+                     pl->buff_bytes_per_pixel;
+}
+
+/*
+    RGB to YUV on 0..255 values. TV range scales luma to 16-235 and
+    chroma to 16-240.
+*/
+static void init_matrix(float* coef, int matrix, bool full_range)
+{
+    double kr = matrix == AR_MATRIX_BT709 ? 0.2126 : 0.299;
+    double kb = matrix == AR_MATRIX_BT709 ? 0.0722 : 0.114;
+    double kg = 1.0 - kr - kb;
+    double y_scale = full_range ? 1.0 : 219.0 / 255.0;
+    double c_scale = full_range ? 1.0 : 224.0 / 255.0;
+    double cb = c_scale / (2.0 * (1.0 - kb));
+    double cr = c_scale / (2.0 * (1.0 - kr));
+    const double m[12] = {
+        kr * y_scale,  kg * y_scale,  kb * y_scale,        full_range ? 0.0 : 16.0,
+        -kr * cb,      -kg * cb,      (1.0 - kb) * cb,     128.0,
+        (1.0 - kr) * cr, -kg * cr,    -kb * cr,            128.0
+    };
+    for (int i = 0; i < 12; i++) {
+        coef[i] = (float)m[i];
+    }
+}
+
+int ar_create_plan(const ar_config_t* config, ar_plan_t** plan)
+{
+    if (!config || !plan) {
+        return AR_ERROR_INVALID;
+    }
+    *plan = NULL;
+    int ret = check_config(config);
+    if (ret != AR_OK) {
+        return ret;
+    }
+
+    ar_plan_t* p = (ar_plan_t*)calloc(1, sizeof(ar_plan_t));
+    if (!p) {
+        return AR_ERROR_NOMEM;
+    }
+    p->config = *config;
+
+    int channels, color_plane;
+    switch (config->format) {
+    case AR_FORMAT_RGB32:
+        p->num_plane = 1;
+        channels = 4;
+        break;
+    case AR_FORMAT_RGB24:
+        p->num_plane = 1;
+        channels = 3;
+        break;
+    default:
+        p->num_plane = config->format == AR_FORMAT_GRAY ? 1 : 3;
+        channels = 1;
+    }
+    color_plane = p->num_plane;
+    if (config->alpha) {
+        p->num_plane++;
+    }
+    p->bytes_per_pixel = config->sample_type == AR_SAMPLE_FLOAT ? sizeof(float) : channels;
+
+    /* the alpha plane has the geometry of luma. */
+    if (!InitParams(p->params, color_plane, config->src_width, config->src_height,
+                    config->target_width, config->target_height,
+                    config->subsample_h, config->subsample_v,
+                    config->output_subsample_h, config->output_subsample_v) ||
+        (config->alpha && !InitParams(p->params + color_plane, 1, config->src_width, config->src_height,
+                                      config->target_width, config->target_height, 1, 1, 1, 1))) {
+        ar_free_plan(p);
+        return AR_ERROR_NOMEM;
+    }
+
+    p->out_plane = p->num_plane;
+    for (int i = 0; i < p->num_plane; i++) {
+        p->out_bytes_per_pixel[i] = p->bytes_per_pixel;
+        p->out_width[i] = p->params[i].target_width;
+        p->out_height[i] = p->params[i].target_height;
+    }
+
+    if (p->config.format != AR_FORMAT_YUV && config->output_format == AR_FORMAT_YUV) {
+        /* horizontal sums of the packed pixels, then ResizeVerticalToYUV(). */
+        const params_t* params = &p->params[0];
+        pipeline_t* pl = &p->pipeline[0];
+        p->to_yuv = true;
+        init_matrix(p->coef, config->matrix, config->full_range != 0);
+        p->out_plane = 3;
+        for (int i = 0; i < 3; i++) {
+            p->out_bytes_per_pixel[i] = 1;
+        }
+        for (int i = 1; i < 3; i++) {
+            p->out_width[i] = config->target_width / config->output_subsample_h;
+            p->out_height[i] = config->target_height / config->output_subsample_v;
+        }
+        pl->first = GetPass(channels, true, PASS_FIRST, SUM_32, SUM_32);
+        pl->buff_bytes_per_pixel = channels * sizeof(uint32_t);
+        pl->buff_pitch = params->target_width * pl->buff_bytes_per_pixel;
+        p->buff_size = (size_t)pl->buff_pitch * params->src_height;
+        p->value_size = (size_t)params->target_width * channels * sizeof(uint64_t) *
+                        config->output_subsample_v;
+        *plan = p;
+        return AR_OK;
+    }
+
+    for (int i = 0; i < p->num_plane; i++) {
+        const params_t* params = &p->params[i];
+        pipeline_t* pl = &p->pipeline[i];
+        init_pipeline(pl, config, params, channels);
+
+        size_t buff_size = 0;
+        if (pl->first) {
+            buff_size = (size_t)pl->buff_pitch *
+                        (pl->vertical_first ? params->target_height : params->src_height);
+        }
+        if (buff_size > p->buff_size) {
+            p->buff_size = buff_size;
+        }
+        if (config->sample_type == AR_SAMPLE_U8 && !config->premultiplied) {
+            /* tensors and temporal averaging always run the horizontal pass first. */
+            size_t sums_size = (size_t)params->target_width * channels * sizeof(uint32_t) * params->src_height;
+            if (sums_size > p->sums_size) {
+                p->sums_size = sums_size;
+            }
+        }
+        size_t value_size = (size_t)params->target_width * channels * sizeof(uint64_t);
+        if (config->premultiplied) {
+            /* the premultiplied source row and the horizontal sums before the output sums. */
+            value_size = (size_t)params->src_width * 4 * sizeof(uint16_t) + 2 * value_size;
+        }
+        if (value_size > p->value_size) {
+            p->value_size = value_size;
+        }
+    }
+
+    if (is_semi_planar(config->output_format)) {
+        /*
+            8bit luma goes through the plane's own pipeline, 16bit luma and
+            the chroma pair through horizontal sums and
+            ResizeVerticalSemiPlanar(). U and V sums share buff one after
+            the other.
+        */
+        int depth = config->output_format == AR_FORMAT_NV12 ? 8 :
+                    config->output_format == AR_FORMAT_P010 ? 10 : 16;
+        int bytes = depth == 8 ? 1 : 2;
+        const params_t* chroma = &p->params[1];
+        p->semi_planar_depth = depth;
+        p->out_plane = 2;
+        p->out_bytes_per_pixel[0] = bytes;
+        p->out_bytes_per_pixel[1] = 2 * bytes;
+        size_t buff_size = (size_t)chroma->target_width * sizeof(uint32_t) * chroma->src_height * 2;
+        if (depth != 8) {
+            size_t luma_size = (size_t)p->params[0].target_width * sizeof(uint32_t) * p->params[0].src_height;
+            buff_size = luma_size > buff_size ? luma_size : buff_size;
+        }
+        if (buff_size > p->buff_size) {
+            p->buff_size = buff_size;
+        }
+        size_t value_size = (size_t)chroma->target_width * sizeof(uint64_t) * 2;
+        if (value_size > p->value_size) {
+            p->value_size = value_size;
+        }
+    }
+
+    *plan = p;
+    return AR_OK;
+}
+
+void ar_free_plan(ar_plan_t* plan)
+{
+    if (!plan) {
+        return;
+    }
+    FreeParams(plan->params, plan->num_plane);
+    free(plan);
+}
+
+int ar_plane_count(const ar_plan_t* plan)
+{
+    return plan->out_plane;
+}
+
+void ar_plane_size(const ar_plan_t* plan, int plane, int* width, int* height)
+{
+    *width = plan->out_width[plane];
+    *height = plan->out_height[plane];
+}
+
+ar_scratch_t* ar_create_scratch(const ar_plan_t* plan)
+{
+    ar_scratch_t* scratch = (ar_scratch_t*)calloc(1, sizeof(ar_scratch_t));
+    if (!scratch) {
+        return NULL;
+    }
+    scratch->buff_size = plan->buff_size;
+    scratch->value_size = plan->value_size;
+    if (plan->buff_size) {
+        scratch->buff = (BYTE*)malloc(plan->buff_size);
+    }
+    scratch->value = malloc(plan->value_size);
+    if ((plan->buff_size && !scratch->buff) || !scratch->value) {
+        ar_free_scratch(scratch);
+        return NULL;
+    }
+    return scratch;
+}
+
+void ar_free_scratch(ar_scratch_t* scratch)
+{
+    if (!scratch) {
+        return;
+    }
+    free(scratch->buff);
+    free(scratch->value);
+    free(scratch->sums);
+    free(scratch);
+}
+
+/*
+    the whole plane sums of ar_resize_tensor() and temporal averaging are
+    larger than what ar_resize() needs, so they are allocated on first use
+    and kept for the next call, instead of with every scratch.
+*/
+static BYTE* scratch_sums(ar_scratch_t* scratch, size_t size)
+{
+    if (size > scratch->sums_size) {
+        free(scratch->sums);
+        scratch->sums = (BYTE*)malloc(size);
+        scratch->sums_size = scratch->sums ? size : 0;
+    }
+    return scratch->sums;
+}
+
+static void copy_plane(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int row_size, int height)
+{
+    for (int y = 0; y < height; y++) {
+        memcpy(dstp, srcp, row_size);
+        dstp += dst_pitch;
+        srcp += src_pitch;
+    }
+}
+
+/* the luma plane (unless it is 8bit) or the UV plane of a semi-planar frame. */
+static void resize_semi_planar(const ar_plan_t* plan, ar_scratch_t* scratch, int plane,
+                               const uint8_t* const* src, const int* src_pitch, BYTE* dstp, int dst_pitch)
+{
+    const params_t* params = &plan->params[plane];
+    int planes = plane ? 2 : 1;
+    int row_size = params->target_width * sizeof(uint32_t);
+    size_t size = (size_t)row_size * params->src_height;
+    pass_t first = GetPass(1, true, PASS_FIRST, SUM_32, SUM_32);
+    const BYTE* sums[2];
+    for (int p = 0; p < planes; p++) {
+        BYTE* buff = scratch->buff + p * size;
+        first(buff, row_size, src[plane + p], src_pitch[plane + p], params, scratch->value);
+        sums[p] = buff;
+    }
+    ResizeVerticalSemiPlanar(dstp, dst_pitch, sums, row_size, planes, params, scratch->value,
+                             plan->semi_planar_depth);
+}
+
+static void resize_plane(const ar_plan_t* plan, ar_scratch_t* scratch, int plane,
+                         const BYTE* srcp, int src_pitch, BYTE* dstp, int dst_pitch)
+{
+    const params_t* params = &plan->params[plane];
+    const pipeline_t* pl = &plan->pipeline[plane];
+
+    if (!pl->second) {
+        copy_plane(dstp, dst_pitch, srcp, src_pitch, params->target_width * plan->bytes_per_pixel,
+                   params->target_height);
+        return;
+    }
+    if (pl->first) {
+        pl->first(scratch->buff, pl->buff_pitch, srcp, src_pitch, params, scratch->value);
+        srcp = scratch->buff;
+        src_pitch = pl->buff_pitch;
+    }
+    pl->second(dstp, dst_pitch, srcp, src_pitch, params, scratch->value);
+}
+
+int ar_resize(const ar_plan_t* plan, ar_scratch_t* scratch,
+              const uint8_t* const* src, const int* src_pitch,
+              uint8_t* const* dst, const int* dst_pitch)
+{
+    return ar_resize_batch(plan, scratch, 1, src, src_pitch, dst, dst_pitch);
+}
+
+int ar_resize_batch(const ar_plan_t* plan, ar_scratch_t* scratch, int count,
+                    const uint8_t* const* src, const int* src_pitch,
+                    uint8_t* const* dst, const int* dst_pitch)
+{
+    if (!plan || !src || !src_pitch || !dst || !dst_pitch || count < 0) {
+        return AR_ERROR_INVALID;
+    }
+
+    ar_scratch_t* tmp = NULL;
+    if (!scratch) {
+        scratch = tmp = ar_create_scratch(plan);
+        if (!scratch) {
+            return AR_ERROR_NOMEM;
+        }
+    } else if (scratch->buff_size < plan->buff_size || scratch->value_size < plan->value_size) {
+        return AR_ERROR_INVALID;
+    }
+
+    int num_plane = plan->num_plane;
+    if (plan->to_yuv) {
+        const params_t* params = &plan->params[0];
+        const pipeline_t* pl = &plan->pipeline[0];
+        for (int f = 0; f < count; f++) {
+            pl->first(scratch->buff, pl->buff_pitch, src[f], src_pitch[0], params, scratch->value);
+            ResizeVerticalToYUV(dst + f * plan->out_plane, dst_pitch, scratch->buff, pl->buff_pitch,
+                                params, scratch->value, plan->bytes_per_pixel,
+                                plan->config.output_subsample_h, plan->config.output_subsample_v,
+                                plan->coef);
+        }
+    } else if (plan->semi_planar_depth) {
+        for (int f = 0; f < count; f++) {
+            const uint8_t* const* s = src + f * num_plane;
+            uint8_t* const* d = dst + f * plan->out_plane;
+            if (plan->semi_planar_depth == 8) {
+                resize_plane(plan, scratch, 0, s[0], src_pitch[0], d[0], dst_pitch[0]);
+            } else {
+                resize_semi_planar(plan, scratch, 0, s, src_pitch, d[0], dst_pitch[0]);
+            }
+        }
+        for (int f = 0; f < count; f++) {
+            resize_semi_planar(plan, scratch, 1, src + f * num_plane, src_pitch,
+                               dst[f * plan->out_plane + 1], dst_pitch[1]);
+        }
+    } else {
+        for (int i = 0; i < num_plane; i++) {
+            for (int f = 0; f < count; f++) {
+                resize_plane(plan, scratch, i, src[f * num_plane + i], src_pitch[i],
+                             dst[f * num_plane + i], dst_pitch[i]);
+            }
+        }
+    }
+
+    ar_free_scratch(tmp);
+    return AR_OK;
+}
+
+static bool check_region(const params_t* params, int x, int y, int width, int height)
+{
+    return x >= 0 && y >= 0 && width > 0 && height > 0 &&
+           x + width <= params->target_width && y + height <= params->target_height;
+}
+
+int ar_source_region(const ar_plan_t* plan, int plane, int x, int y, int width, int height,
+                     int* src_x, int* src_y, int* src_width, int* src_height)
+{
+    if (!plan || plane < 0 || plane >= plan->num_plane ||
+        !check_region(&plan->params[plane], x, y, width, height)) {
+        return AR_ERROR_INVALID;
+    }
+    if (converts(plan)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    const axis_t* h = &plan->params[plane].axis_h;
+    const axis_t* v = &plan->params[plane].axis_v;
+    *src_x = h->start[x];
+    *src_width = h->start[x + width - 1] + h->taps - *src_x;
+    *src_y = v->start[y];
+    *src_height = v->start[y + height - 1] + v->taps - *src_y;
+    return AR_OK;
+}
+
+/*
+    the kernels take their geometry from params_t only, so a region is
+    resized by handing them a copy whose tables start at the first output
+    sample of the region.
+*/
+static params_t region_view(const params_t* params, int x, int y, int width, int height)
+{
+    params_t view = *params;
+    view.target_width = width;
+    view.target_height = height;
+    view.axis_h.start += x;
+    view.axis_h.weight += x * view.axis_h.taps;
+    view.axis_h.fweight += x * view.axis_h.taps;
+    view.axis_v.start += y;
+    view.axis_v.weight += y * view.axis_v.taps;
+    view.axis_v.fweight += y * view.axis_v.taps;
+    return view;
+}
+
+/*
+    the intermediate keeps the layout of the full plane, which lets the
+    second pass use absolute source positions.
+*/
+int ar_resize_region(const ar_plan_t* plan, ar_scratch_t* scratch, int plane,
+                     const uint8_t* src, int src_pitch, uint8_t* dst, int dst_pitch,
+                     int x, int y, int width, int height)
+{
+    if (!plan || !scratch || !src || !dst || plane < 0 || plane >= plan->num_plane ||
+        !check_region(&plan->params[plane], x, y, width, height)) {
+        return AR_ERROR_INVALID;
+    }
+    if (scratch->buff_size < plan->buff_size || scratch->value_size < plan->value_size) {
+        return AR_ERROR_INVALID;
+    }
+    if (converts(plan)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+
+    const params_t* params = &plan->params[plane];
+    const pipeline_t* pl = &plan->pipeline[plane];
+    int bpp = plan->bytes_per_pixel;
+    dst += y * dst_pitch + x * bpp;
+
+    if (!pl->second) {
+        copy_plane(dst, dst_pitch, src + y * src_pitch + x * bpp, src_pitch, width * bpp, height);
+        return AR_OK;
+    }
+
+    params_t view = region_view(params, x, y, width, height);
+
+    int src_x, src_y, src_width, src_height;
+    ar_source_region(plan, plane, x, y, width, height, &src_x, &src_y, &src_width, &src_height);
+
+    if (!pl->first) {
+        /*
+            the axis that keeps its size maps output to source one to one.
+            the premultiplied pass reads both axes at absolute positions.
+        */
+        if (!plan->config.premultiplied) {
+            if (params->src_height == params->target_height) {
+                view.src_height = height;
+                src += y * src_pitch;
+            } else {
+                view.src_width = width;
+                src += x * bpp;
+            }
+        }
+        pl->second(dst, dst_pitch, src, src_pitch, &view, scratch->value);
+        return AR_OK;
+    }
+
+    int ibpp = pl->buff_bytes_per_pixel;
+    params_t first = view;
+    if (pl->vertical_first) {
+        first.src_width = src_width;
+        pl->first(scratch->buff + y * pl->buff_pitch + src_x * ibpp, pl->buff_pitch,
+                  src + src_x * bpp, src_pitch, &first, scratch->value);
+        pl->second(dst, dst_pitch, scratch->buff + y * pl->buff_pitch, pl->buff_pitch,
+                   &view, scratch->value);
+    } else {
+        first.src_height = src_height;
+        pl->first(scratch->buff + src_y * pl->buff_pitch + x * ibpp, pl->buff_pitch,
+                  src + src_y * src_pitch, src_pitch, &first, scratch->value);
+        pl->second(dst, dst_pitch, scratch->buff + x * ibpp, pl->buff_pitch, &view, scratch->value);
+    }
+    return AR_OK;
+}
+
+/*
+    row streaming. every plane runs horizontal first here, whatever the
+    plan's order, so the first pass can consume source rows as they come
+    in; the vertical pass then produces every output row whose source
+    window is complete. a plane that only shrinks vertically keeps its
+    source rows instead, one that only shrinks horizontally goes straight
+    to dst.
+
+    buff is a window of the rows from 'base' on: rows before the source
+    window of the next output row are dropped on every push, so it holds
+    one band plus the taps of a single output row whatever the height of
+    the source. the vertical pass reads it through a copy of the start
+    table made relative to base.
+*/
+struct ar_stream {
+    const ar_plan_t* plan;
+    pipeline_t pipeline[AR_MAX_PLANES];
+    BYTE* buff[AR_MAX_PLANES];
+    int buff_pitch[AR_MAX_PLANES];
+    int buff_rows[AR_MAX_PLANES];
+    int base[AR_MAX_PLANES];
+    int* start;
+    void* value;
+    uint8_t* dst[AR_MAX_PLANES];
+    int dst_pitch[AR_MAX_PLANES];
+    int rows_in[AR_MAX_PLANES];
+    int rows_out[AR_MAX_PLANES];
+    ar_rows_func_t func;
+    void* user;
+};
+
+int ar_create_stream(const ar_plan_t* plan, ar_stream_t** stream)
+{
+    if (!plan || !stream) {
+        return AR_ERROR_INVALID;
+    }
+    *stream = NULL;
+    if (converts(plan)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    ar_stream_t* s = (ar_stream_t*)calloc(1, sizeof(ar_stream_t));
+    if (!s) {
+        return AR_ERROR_NOMEM;
+    }
+    s->plan = plan;
+
+    ar_config_t config = plan->config;
+    config.order = AR_ORDER_HORIZONTAL_FIRST;
+    int channels = config.sample_type == AR_SAMPLE_FLOAT ? 1 : plan->bytes_per_pixel;
+    for (int i = 0; i < plan->num_plane; i++) {
+        const params_t* params = &plan->params[i];
+        pipeline_t* pl = &s->pipeline[i];
+        init_pipeline(pl, &config, params, channels);
+        if (pl->first) {
+            s->buff_pitch[i] = pl->buff_pitch;
+        } else if (pl->second && (params->src_height != params->target_height || config.premultiplied)) {
+            /* source rows the single pass reads at absolute positions. */
+            s->buff_pitch[i] = params->src_width * plan->bytes_per_pixel;
+        }
+    }
+    s->start = (int*)malloc(sizeof(int) * plan->config.target_height);
+    s->value = malloc(plan->value_size);
+    if (!s->start || !s->value) {
+        ar_free_stream(s);
+        return AR_ERROR_NOMEM;
+    }
+
+    *stream = s;
+    return AR_OK;
+}
+
+void ar_free_stream(ar_stream_t* stream)
+{
+    if (!stream) {
+        return;
+    }
+    for (int i = 0; i < AR_MAX_PLANES; i++) {
+        free(stream->buff[i]);
+    }
+    free(stream->start);
+    free(stream->value);
+    free(stream);
+}
+
+int ar_begin_frame(ar_stream_t* stream, uint8_t* const* dst, const int* dst_pitch,
+                   ar_rows_func_t func, void* user)
+{
+    if (!stream || !dst || !dst_pitch) {
+        return AR_ERROR_INVALID;
+    }
+    for (int i = 0; i < stream->plan->num_plane; i++) {
+        stream->dst[i] = dst[i];
+        stream->dst_pitch[i] = dst_pitch[i];
+        stream->rows_in[i] = 0;
+        stream->rows_out[i] = 0;
+        stream->base[i] = 0;
+    }
+    stream->func = func;
+    stream->user = user;
+    return AR_OK;
+}
+
+/*
+    drops the rows no pending output row reads and makes room for 'rows'
+    more. returns where they go, or NULL when out of memory.
+*/
+static BYTE* window_append(ar_stream_t* stream, int plane, int rows)
+{
+    const params_t* params = &stream->plan->params[plane];
+    int pitch = stream->buff_pitch[plane];
+    int rows_in = stream->rows_in[plane];
+    int keep = stream->rows_out[plane] < params->target_height ?
+               params->axis_v.start[stream->rows_out[plane]] : rows_in;
+    if (keep > rows_in) {
+        keep = rows_in;
+    }
+    int drop = keep - stream->base[plane];
+    int count = rows_in - keep;
+    if (drop > 0 && count > 0) {
+        memmove(stream->buff[plane], stream->buff[plane] + (size_t)drop * pitch, (size_t)count * pitch);
+    }
+    stream->base[plane] = keep;
+
+    if (count + rows > stream->buff_rows[plane]) {
+        BYTE* buff = (BYTE*)realloc(stream->buff[plane], (size_t)(count + rows) * pitch);
+        if (!buff) {
+            return NULL;
+        }
+        stream->buff[plane] = buff;
+        stream->buff_rows[plane] = count + rows;
+    }
+    return stream->buff[plane] + (size_t)count * pitch;
+}
+
+static int push_plane(ar_stream_t* stream, int plane, const BYTE* srcp, int src_pitch, int rows)
+{
+    const ar_plan_t* plan = stream->plan;
+    const params_t* params = &plan->params[plane];
+    const pipeline_t* pl = &stream->pipeline[plane];
+    int bpp = plan->bytes_per_pixel;
+    int y = stream->rows_in[plane];
+    BYTE* dstp = stream->dst[plane];
+    int dst_pitch = stream->dst_pitch[plane];
+
+    if (!stream->buff_pitch[plane]) {
+        /* no vertical window: every source row is an output row. */
+        if (pl->second) {
+            params_t view = region_view(params, 0, y, params->target_width, rows);
+            view.src_height = rows;
+            pl->second(dstp + (size_t)y * dst_pitch, dst_pitch, srcp, src_pitch, &view, stream->value);
+        } else {
+            copy_plane(dstp + (size_t)y * dst_pitch, dst_pitch, srcp, src_pitch,
+                       params->target_width * bpp, rows);
+        }
+        stream->rows_in[plane] += rows;
+        stream->rows_out[plane] = stream->rows_in[plane];
+        if (stream->func) {
+            stream->func(stream->user, plane, y, rows);
+        }
+        return AR_OK;
+    }
+
+    BYTE* band = window_append(stream, plane, rows);
+    if (!band) {
+        return AR_ERROR_NOMEM;
+    }
+    int buff_pitch = stream->buff_pitch[plane];
+    if (pl->first) {
+        params_t view = *params;
+        view.src_height = rows;
+        pl->first(band, buff_pitch, srcp, src_pitch, &view, stream->value);
+    } else {
+        copy_plane(band, buff_pitch, srcp, src_pitch, buff_pitch, rows);
+    }
+    stream->rows_in[plane] += rows;
+
+    const axis_t* v = &params->axis_v;
+    int first = stream->rows_out[plane];
+    int last = first;
+    int base = stream->base[plane];
+    while (last < params->target_height &&
+           (v->start[last] + v->taps <= stream->rows_in[plane] ||
+            stream->rows_in[plane] == params->src_height)) {
+        stream->start[last] = v->start[last] - base;
+        last++;
+    }
+    if (last == first) {
+        return AR_OK;
+    }
+    params_t view = region_view(params, 0, first, params->target_width, last - first);
+    view.axis_v.start = stream->start + first;
+    pl->second(dstp + (size_t)first * dst_pitch, dst_pitch, stream->buff[plane], buff_pitch,
+               &view, stream->value);
+    stream->rows_out[plane] = last;
+    if (stream->func) {
+        stream->func(stream->user, plane, first, last - first);
+    }
+    return AR_OK;
+}
+
+int ar_push_rows(ar_stream_t* stream, const uint8_t* const* src, const int* src_pitch, int rows)
+{
+    if (!stream || !src || !src_pitch || rows < 1) {
+        return AR_ERROR_INVALID;
+    }
+    const ar_plan_t* plan = stream->plan;
+    int sub_v = plan->config.subsample_v;
+    if (!stream->dst[0] || stream->rows_in[0] + rows > plan->config.src_height ||
+        (plan->num_plane > 1 && rows % sub_v)) {
+        return AR_ERROR_INVALID;
+    }
+    for (int i = 0; i < plan->num_plane; i++) {
+        /* only chroma is subsampled; luma and alpha take all the rows. */
+        bool full = plan->params[i].src_height == plan->config.src_height;
+        int ret = push_plane(stream, i, src[i], src_pitch[i], full ? rows : rows / sub_v);
+        if (ret != AR_OK) {
+            return ret;
+        }
+    }
+    return AR_OK;
+}
+
+void ar_init_tensor(ar_tensor_t* tensor, int type)
+{
+    tensor->type = type;
+    tensor->channels = 0;
+    for (int c = 0; c < 4; c++) {
+        tensor->order[c] = c;
+        tensor->scale[c] = 1.0f / 255.0f;
+        tensor->bias[c] = 0.0f;
+    }
+}
+
+int ar_resize_tensor(const ar_plan_t* plan, ar_scratch_t* scratch, const ar_tensor_t* tensor,
+                     const uint8_t* const* src, const int* src_pitch, void* dst)
+{
+    return ar_resize_tensor_batch(plan, scratch, tensor, 1, src, src_pitch, dst);
+}
+
+int ar_resize_tensor_batch(const ar_plan_t* plan, ar_scratch_t* scratch, const ar_tensor_t* tensor,
+                           int count, const uint8_t* const* src, const int* src_pitch, void* dst)
+{
+    if (!plan || !tensor || !src || !src_pitch || !dst || count < 0 ||
+        (tensor->type != AR_TENSOR_FLOAT32 && tensor->type != AR_TENSOR_FLOAT16)) {
+        return AR_ERROR_INVALID;
+    }
+    if (plan->config.sample_type != AR_SAMPLE_U8 || plan->config.premultiplied || converts(plan)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+
+    int num_plane = plan->num_plane;
+    int src_channels = num_plane > 1 ? num_plane : plan->bytes_per_pixel;
+    int channels = tensor->channels ? tensor->channels : src_channels;
+    if (channels < 1 || channels > src_channels) {
+        return AR_ERROR_INVALID;
+    }
+    for (int c = 0; c < channels; c++) {
+        if (tensor->order[c] < 0 || tensor->order[c] >= src_channels) {
+            return AR_ERROR_INVALID;
+        }
+    }
+    for (int i = 1; i < num_plane; i++) {
+        if (plan->params[i].target_width != plan->params[0].target_width ||
+            plan->params[i].target_height != plan->params[0].target_height) {
+            return AR_ERROR_UNSUPPORTED;
+        }
+    }
+
+    ar_scratch_t* tmp = NULL;
+    if (!scratch) {
+        scratch = tmp = ar_create_scratch(plan);
+        if (!scratch) {
+            return AR_ERROR_NOMEM;
+        }
+    } else if (scratch->buff_size < plan->buff_size || scratch->value_size < plan->value_size) {
+        return AR_ERROR_INVALID;
+    }
+    BYTE* sums = scratch_sums(scratch, plan->sums_size);
+    if (!sums) {
+        ar_free_scratch(tmp);
+        return AR_ERROR_NOMEM;
+    }
+
+    const params_t* params = &plan->params[0];
+    int pixel_channels = num_plane > 1 ? 1 : src_channels;
+    int row_size = params->target_width * pixel_channels * sizeof(uint32_t);
+    long long plane_size = (long long)params->target_width * params->target_height;
+    size_t element_size = tensor->type == AR_TENSOR_FLOAT16 ? 2 : 4;
+
+    float mul[4], add[4];
+    for (int c = 0; c < channels; c++) {
+        mul[c] = tensor->scale[c] / ((float)params->den_h * params->den_v);
+        add[c] = tensor->bias[c];
+    }
+
+    for (int f = 0; f < count; f++) {
+        BYTE* frame = (BYTE*)dst + (size_t)f * channels * plane_size * element_size;
+        /* planar: one pass per output channel. packed: one pass for all of them. */
+        for (int c = 0; c < (num_plane > 1 ? channels : 1); c++) {
+            int i = num_plane > 1 ? tensor->order[c] : 0;
+            const BYTE* srcp = src[f * num_plane + i];
+            int pitch = src_pitch[i];
+            pass_t first = GetPass(pixel_channels, true, PASS_FIRST, SUM_32, SUM_32);
+            first(sums, row_size, srcp, pitch, &plan->params[i], scratch->value);
+            srcp = sums;
+            pitch = row_size;
+            if (num_plane > 1) {
+                const int order = 0;
+                ResizeVerticalTensor(frame + c * plane_size * element_size, tensor->type, plane_size,
+                                     srcp, pitch, &plan->params[i], scratch->value, 1, 1,
+                                     &order, mul + c, add + c);
+            } else {
+                ResizeVerticalTensor(frame, tensor->type, plane_size, srcp, pitch, params,
+                                     scratch->value, src_channels, channels, tensor->order, mul, add);
+            }
+        }
+    }
+
+    ar_free_scratch(tmp);
+    return AR_OK;
+}
+
+/*
+    temporal averaging. time is one more axis with the same scheme: output
+    frame n spans [n * den, (n + 1) * den) and source frame k spans
+    [k * num, (k + 1) * num) in units of 1 / (num * rate), and k is
+    weighted by the overlap. every source frame runs the horizontal sum
+    pass and a vertical pass that adds into acc, which is divided once by
+    den_h * den_v * den at the end, so only the final value is rounded.
+*/
+struct ar_temporal {
+    const ar_plan_t* plan;
+    int num;
+    int den;
+    ar_scratch_t* scratch;
+    uint64_t* acc;
+};
+
+int ar_create_temporal(const ar_plan_t* plan, int num, int den, ar_temporal_t** temporal)
+{
+    if (!plan || !temporal || num < 1 || den < 1) {
+        return AR_ERROR_INVALID;
+    }
+    *temporal = NULL;
+    const ar_config_t* config = &plan->config;
+    if (num > den || config->sample_type != AR_SAMPLE_U8 || config->premultiplied || converts(plan)) {
+        return AR_ERROR_UNSUPPORTED;
+    }
+    int g = gcd(num, den);
+    num /= g;
+    den /= g;
+    size_t acc_size = 0;
+    for (int i = 0; i < plan->num_plane; i++) {
+        const params_t* params = &plan->params[i];
+        if (255.0 * params->den_h * params->den_v * den > 1.8e19) {
+            return AR_ERROR_UNSUPPORTED;
+        }
+        acc_size += (size_t)params->target_width * params->target_height * plan->bytes_per_pixel;
+    }
+
+    ar_temporal_t* t = (ar_temporal_t*)calloc(1, sizeof(ar_temporal_t));
+    if (!t) {
+        return AR_ERROR_NOMEM;
+    }
+    t->plan = plan;
+    t->num = num;
+    t->den = den;
+    t->scratch = ar_create_scratch(plan);
+    t->acc = (uint64_t*)malloc(acc_size * sizeof(uint64_t));
+    if (!t->scratch || !t->acc || !scratch_sums(t->scratch, plan->sums_size)) {
+        ar_free_temporal(t);
+        return AR_ERROR_NOMEM;
+    }
+    *temporal = t;
+    return AR_OK;
+}
+
+void ar_free_temporal(ar_temporal_t* temporal)
+{
+    if (!temporal) {
+        return;
+    }
+    ar_free_scratch(temporal->scratch);
+    free(temporal->acc);
+    free(temporal);
+}
+
+int ar_temporal_frames(const ar_temporal_t* temporal, int src_frames)
+{
+    return (int)((long long)src_frames * temporal->num / temporal->den);
+}
+
+void ar_temporal_sources(const ar_temporal_t* temporal, int n, int* first, int* count)
+{
+    long long lo = (long long)n * temporal->den;
+    long long hi = lo + temporal->den;
+    *first = (int)(lo / temporal->num);
+    *count = (int)((hi - 1) / temporal->num) - *first + 1;
+}
+
+int ar_resize_temporal(ar_temporal_t* temporal, int n, const uint8_t* const* src, const int* src_pitch,
+                       uint8_t* const* dst, const int* dst_pitch)
+{
+    if (!temporal || n < 0 || !src || !src_pitch || !dst || !dst_pitch) {
+        return AR_ERROR_INVALID;
+    }
+    const ar_plan_t* plan = temporal->plan;
+    ar_scratch_t* scratch = temporal->scratch;
+    int num_plane = plan->num_plane;
+    int channels = plan->bytes_per_pixel;
+    int first, count;
+    ar_temporal_sources(temporal, n, &first, &count);
+    long long lo = (long long)n * temporal->den;
+    long long hi = lo + temporal->den;
+    pass_t pass = GetPass(channels, true, PASS_FIRST, SUM_32, SUM_32);
+
+    uint64_t* acc = temporal->acc;
+    for (int i = 0; i < num_plane; i++) {
+        const params_t* params = &plan->params[i];
+        int buff_pitch = params->target_width * channels * sizeof(uint32_t);
+        for (int f = 0; f < count; f++) {
+            long long begin = (long long)(first + f) * temporal->num;
+            long long end = begin + temporal->num;
+            int weight = (int)((end < hi ? end : hi) - (begin > lo ? begin : lo));
+            pass(scratch->sums, buff_pitch, src[f * num_plane + i], src_pitch[i], params, scratch->value);
+            ResizeVerticalAccumulate(acc, scratch->sums, buff_pitch, params, channels, weight, f == 0);
+        }
+
+        uint64_t den = (uint64_t)params->den_h * params->den_v * temporal->den;
+        int row_size = params->target_width * channels;
+        for (int y = 0; y < params->target_height; y++) {
+            BYTE* d = dst[i] + y * dst_pitch[i];
+            for (int x = 0; x < row_size; x++) {
+                d[x] = (BYTE)(acc[x] / den);
+            }
+            acc += row_size;
+        }
+    }
+    return AR_OK;
+}
+
+/*
+    autotune. the only kernel choice this library has is the pass order, so
+    both orders are timed on a synthetic frame of the real geometry and the
+    faster one is stored in a text file, one "key<TAB>order" line per
+    geometry. the key holds the library version and the cpu model, so a
+    cache shared between machines or kept over an upgrade stays valid.
+*/
+static double now_ms()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return count.QuadPart * 1000.0 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static void cpu_model(char* model, size_t size)
+{
+    unsigned int regs[12] = {0};
+#if defined(_WIN32)
+    int info[4];
+    __cpuid(info, 0x80000000);
+    if ((unsigned int)info[0] >= 0x80000004) {
+        for (int i = 0; i < 3; i++) {
+            __cpuid((int*)(regs + i * 4), 0x80000002 + i);
+        }
+    }
+#elif defined(__i386__) || defined(__x86_64__)
+    if (__get_cpuid_max(0x80000000, NULL) >= 0x80000004) {
+        for (unsigned int i = 0; i < 3; i++) {
+            __get_cpuid(0x80000002 + i, regs + i * 4, regs + i * 4 + 1, regs + i * 4 + 2, regs + i * 4 + 3);
+        }
+    }
+#endif
+    char brand[49] = {0};
+    memcpy(brand, regs, 48);
+    const char* p = brand;
+    while (*p == ' ') {
+        p++;
+    }
+    snprintf(model, size, "%s", *p ? p : "unknown");
+}
+
+static bool default_cache_path(char* path, size_t size)
+{
+#ifdef _WIN32
+    const char* dir = getenv("LOCALAPPDATA");
+    if (!dir) {
+        return false;
+    }
+    snprintf(path, size, "%s\\arearesize_tune.txt", dir);
+#else
+    const char* dir = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (dir && *dir) {
+        snprintf(path, size, "%s/arearesize_tune.txt", dir);
+    } else if (home && *home) {
+        snprintf(path, size, "%s/.cache/arearesize_tune.txt", home);
+    } else {
+        return false;
+    }
+#endif
+    return true;
+}
+
+static int lookup_order(const char* path, const char* key)
+{
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return AR_ORDER_AUTO;
+    }
+    char line[512];
+    size_t len = strlen(key);
+    int order = AR_ORDER_AUTO;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, len) == 0 && line[len] == '\t') {
+            int o = atoi(line + len + 1);
+            if (o == AR_ORDER_HORIZONTAL_FIRST || o == AR_ORDER_VERTICAL_FIRST) {
+                order = o;
+            }
+        }
+    }
+    fclose(fp);
+    return order;
+}
+
+/* best of a few runs, after one to warm up the caches. */
+static double time_plan(const ar_plan_t* plan, ar_scratch_t* scratch, const uint8_t* const* src,
+                        const int* src_pitch, uint8_t* const* dst, const int* dst_pitch)
+{
+    double best = 0.0;
+    ar_resize(plan, scratch, src, src_pitch, dst, dst_pitch);
+    for (int i = 0; i < 3; i++) {
+        double start = now_ms();
+        ar_resize(plan, scratch, src, src_pitch, dst, dst_pitch);
+        double t = now_ms() - start;
+        if (i == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+int ar_autotune(ar_config_t* config, const char* cache_path)
+{
+    if (!config) {
+        return AR_ERROR_INVALID;
+    }
+    int ret = check_config(config);
+    if (ret != AR_OK || config->order != AR_ORDER_AUTO ||
+        config->sample_type != AR_SAMPLE_U8 || config->premultiplied ||
+        config->output_format != config->format || config->src_width == config->target_width ||
+        config->src_height == config->target_height) {
+        return ret;
+    }
+
+    char path[1024];
+    if (!cache_path && default_cache_path(path, sizeof(path))) {
+        cache_path = path;
+    }
+    char model[64], key[256];
+    cpu_model(model, sizeof(model));
+    snprintf(key, sizeof(key), "%s|%s|%d/%d/%d/%d/%d/%d/%d|%dx%d|%dx%d", AR_VERSION, model,
+             config->format, config->sample_type, config->subsample_h, config->subsample_v,
+             config->output_subsample_h, config->output_subsample_v, config->alpha != 0,
+             config->src_width, config->src_height, config->target_width, config->target_height);
+
+    int order = cache_path ? lookup_order(cache_path, key) : AR_ORDER_AUTO;
+    if (order != AR_ORDER_AUTO) {
+        config->order = order;
+        return AR_OK;
+    }
+
+    ar_config_t candidate[2] = {*config, *config};
+    candidate[0].order = AR_ORDER_HORIZONTAL_FIRST;
+    candidate[1].order = AR_ORDER_VERTICAL_FIRST;
+    ar_plan_t* plan[2] = {NULL, NULL};
+    ar_scratch_t* scratch[2] = {NULL, NULL};
+    uint8_t* src[AR_MAX_PLANES] = {NULL};
+    uint8_t* dst[AR_MAX_PLANES] = {NULL};
+    int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+    int num_plane = 0;
+    ret = AR_ERROR_NOMEM;
+
+    for (int c = 0; c < 2; c++) {
+        int r = ar_create_plan(&candidate[c], &plan[c]);
+        if (r != AR_OK) {
+            ret = r;
+            goto end;
+        }
+        if (!(scratch[c] = ar_create_scratch(plan[c]))) {
+            goto end;
+        }
+    }
+
+    num_plane = plan[0]->num_plane;
+    for (int i = 0; i < num_plane; i++) {
+        const params_t* params = &plan[0]->params[i];
+        src_pitch[i] = params->src_width * plan[0]->bytes_per_pixel;
+        dst_pitch[i] = params->target_width * plan[0]->bytes_per_pixel;
+        src[i] = (uint8_t*)malloc((size_t)src_pitch[i] * params->src_height);
+        dst[i] = (uint8_t*)malloc((size_t)dst_pitch[i] * params->target_height);
+        if (!src[i] || !dst[i]) {
+            goto end;
+        }
+        unsigned int seed = 12345;
+        for (size_t j = 0; j < (size_t)src_pitch[i] * params->src_height; j++) {
+            seed = seed * 1103515245 + 12345;
+            src[i][j] = (uint8_t)(seed >> 24);
+        }
+    }
+
+    {
+        double t0 = time_plan(plan[0], scratch[0], src, src_pitch, dst, dst_pitch);
+        double t1 = time_plan(plan[1], scratch[1], src, src_pitch, dst, dst_pitch);
+        config->order = t1 < t0 ? AR_ORDER_VERTICAL_FIRST : AR_ORDER_HORIZONTAL_FIRST;
+    }
+    if (cache_path) {
+        FILE* fp = fopen(cache_path, "a");
+        if (fp) {
+            fprintf(fp, "%s\t%d\n", key, config->order);
+            fclose(fp);
+        }
+    }
+    ret = AR_OK;
+
+end:
+    for (int i = 0; i < num_plane; i++) {
+        free(src[i]);
+        free(dst[i]);
+    }
+    for (int c = 0; c < 2; c++) {
+        ar_free_scratch(scratch[c]);
+        ar_free_plan(plan[c]);
+    }
+    return ret;
+}
+
+/*
+    thumbnail file: the header, one 'written' byte per frame padded to 16,
+    then the thumbnails back to back.
+*/
+#define THUMB_MAGIC "ARTHUMB1"
+#define THUMB_HEADER_SIZE 32
+
+struct ar_thumbs {
+    mapped_file_t* file;
+    ar_plan_t* plan;
+    ar_temporal_t* temporal;
+    int frames;
+    int width;
+    int height;
+    uint8_t* written;
+    uint8_t* data;
+};
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int ar_open_thumbs(const char* path, int frames, int luma_width, int luma_height,
+                   int width, int height, ar_thumbs_t** thumbs)
+{
+    if (!path || !thumbs || frames < 1 || width < 1 || height < 1) {
+        return AR_ERROR_INVALID;
+    }
+    *thumbs = NULL;
+    ar_thumbs_t* t = (ar_thumbs_t*)calloc(1, sizeof(ar_thumbs_t));
+    if (!t) {
+        return AR_ERROR_NOMEM;
+    }
+    t->frames = frames;
+    t->width = width;
+    t->height = height;
+
+    ar_config_t config;
+    ar_init_config(&config, luma_width, luma_height, width, height, AR_FORMAT_GRAY, 1, 1);
+    int ret = ar_create_plan(&config, &t->plan);
+    if (ret != AR_OK) {
+        free(t);
+        return ret;
+    }
+
+    int64_t offset = THUMB_HEADER_SIZE + ((frames + 15) & ~15);
+    t->file = OpenMappedFile(path, offset + (int64_t)frames * width * height, true);
+    if (!t->file) {
+        ar_close_thumbs(t);
+        return AR_ERROR_INVALID;
+    }
+    uint8_t* header = MappedData(t->file);
+    t->written = header + THUMB_HEADER_SIZE;
+    t->data = header + offset;
+
+    /* a file left by an earlier run with the same layout keeps its thumbnails. */
+    if (memcmp(header, THUMB_MAGIC, 8) || get_u32(header + 8) != (uint32_t)width ||
+        get_u32(header + 12) != (uint32_t)height || get_u32(header + 16) != (uint32_t)frames) {
+        memset(header, 0, (size_t)offset);
+        memcpy(header, THUMB_MAGIC, 8);
+        put_u32(header + 8, width);
+        put_u32(header + 12, height);
+        put_u32(header + 16, frames);
+    }
+
+    *thumbs = t;
+    return AR_OK;
+}
+
+void ar_close_thumbs(ar_thumbs_t* thumbs)
+{
+    if (!thumbs) {
+        return;
+    }
+    CloseMappedFile(thumbs->file);
+    ar_free_temporal(thumbs->temporal);
+    ar_free_plan(thumbs->plan);
+    free(thumbs);
+}
+
+int ar_write_thumb(ar_thumbs_t* thumbs, int n, const uint8_t* luma, int pitch)
+{
+    if (!thumbs || !luma || n < 0 || n >= thumbs->frames) {
+        return AR_ERROR_INVALID;
+    }
+    uint8_t* dst = thumbs->data + (size_t)n * thumbs->width * thumbs->height;
+    int ret = ar_resize(thumbs->plan, NULL, &luma, &pitch, &dst, &thumbs->width);
+    if (ret == AR_OK) {
+        thumbs->written[n] = 1;
+    }
+    return ret;
+}
+
+int ar_thumbs_temporal(ar_thumbs_t* thumbs, int num, int den)
+{
+    if (!thumbs || thumbs->temporal) {
+        return AR_ERROR_INVALID;
+    }
+    return ar_create_temporal(thumbs->plan, num, den, &thumbs->temporal);
+}
+
+/* the temporal object keeps its own sums, so these are not written from several threads. */
+int ar_write_thumb_temporal(ar_thumbs_t* thumbs, int n, const uint8_t* const* luma, int pitch)
+{
+    if (!thumbs || !thumbs->temporal || !luma || n < 0 || n >= thumbs->frames) {
+        return AR_ERROR_INVALID;
+    }
+    uint8_t* dst = thumbs->data + (size_t)n * thumbs->width * thumbs->height;
+    int ret = ar_resize_temporal(thumbs->temporal, n, luma, &pitch, &dst, &thumbs->width);
+    if (ret == AR_OK) {
+        thumbs->written[n] = 1;
+    }
+    return ret;
+}
+
+const uint8_t* ar_thumb(const ar_thumbs_t* thumbs, int n)
+{
+    if (!thumbs || n < 0 || n >= thumbs->frames || !thumbs->written[n]) {
+        return NULL;
+    }
+    return thumbs->data + (size_t)n * thumbs->width * thumbs->height;
+}
+
+uint64_t ar_hash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = seed ^ 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*
+    frame cache file: the header, then 'slots' index entries of key and
+    last use, then the slots. a slot is the output planes of the plan
+    packed without padding, followed by the uint32 size and the bytes of
+    the caller's metadata, so every slot has the same size. frames are
+    appended to the next unused slot; once all are used, the least
+    recently used one is overwritten. a slot's key is cleared while its
+    frame is being replaced.
+*/
+#define CACHE_MAGIC "ARCACHE2"
+#define CACHE_HEADER_SIZE 64
+#define CACHE_ENTRY_SIZE 16
+
+struct ar_cache {
+    mapped_file_t* file;
+    const ar_plan_t* plan;
+    uint8_t* header;
+    uint8_t* index;
+    uint8_t* data;
+    int slots;
+    int64_t frame_size;
+    int64_t slot_size;
+    uint64_t config_key;
+};
+
+static void put_u64(uint8_t* p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+    return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+int ar_open_cache(const char* path, const ar_plan_t* plan, int64_t max_bytes, ar_cache_t** cache)
+{
+    if (!path || !plan || !cache) {
+        return AR_ERROR_INVALID;
+    }
+    *cache = NULL;
+    int64_t frame_size = 0;
+    for (int i = 0; i < plan->out_plane; i++) {
+        frame_size += (int64_t)plan->out_width[i] * plan->out_height[i] * plan->out_bytes_per_pixel[i];
+    }
+    int64_t slot_size = frame_size + 4 + AR_CACHE_META_SIZE;
+    int64_t slots = (max_bytes - CACHE_HEADER_SIZE) / (slot_size + CACHE_ENTRY_SIZE);
+    if (slots < 1) {
+        return AR_ERROR_INVALID;
+    }
+    if (slots > 0x7fffffff) {
+        slots = 0x7fffffff;
+    }
+
+    ar_cache_t* c = (ar_cache_t*)calloc(1, sizeof(ar_cache_t));
+    if (!c) {
+        return AR_ERROR_NOMEM;
+    }
+    c->plan = plan;
+    c->slots = (int)slots;
+    c->frame_size = frame_size;
+    c->slot_size = slot_size;
+    int64_t index_size = slots * CACHE_ENTRY_SIZE;
+    c->file = OpenMappedFile(path, CACHE_HEADER_SIZE + index_size + slots * slot_size, true);
+    if (!c->file) {
+        free(c);
+        return AR_ERROR_INVALID;
+    }
+    c->header = MappedData(c->file);
+    c->index = c->header + CACHE_HEADER_SIZE;
+    c->data = c->index + index_size;
+
+    /* everything that changes the output except the source and frame number. */
+    const ar_config_t* cf = &plan->config;
+    int config[13] = {cf->target_width, cf->target_height, cf->format, cf->subsample_h,
+                      cf->subsample_v, cf->sample_type, cf->premultiplied, cf->output_format,
+                      cf->output_subsample_h, cf->output_subsample_v, cf->matrix, cf->full_range != 0, cf->alpha != 0};
+    c->config_key = ar_hash64(config, sizeof(config), 0);
+
+    uint8_t* h = c->header;
+    if (memcmp(h, CACHE_MAGIC, 8) || get_u64(h + 8) != (uint64_t)frame_size ||
+        get_u32(h + 16) != (uint32_t)slots) {
+        memset(h, 0, (size_t)(CACHE_HEADER_SIZE + index_size));
+        memcpy(h, CACHE_MAGIC, 8);
+        put_u64(h + 8, frame_size);
+        put_u32(h + 16, (uint32_t)slots);
+    }
+
+    *cache = c;
+    return AR_OK;
+}
+
+void ar_close_cache(ar_cache_t* cache)
+{
+    if (!cache) {
+        return;
+    }
+    CloseMappedFile(cache->file);
+    free(cache);
+}
+
+/* header: +20 uint32 slots in use, +24 uint64 use counter. */
+static uint64_t cache_tick(ar_cache_t* cache)
+{
+    uint64_t tick = get_u64(cache->header + 24) + 1;
+    put_u64(cache->header + 24, tick);
+    return tick;
+}
+
+static uint64_t cache_key(const ar_cache_t* cache, uint64_t source, int n)
+{
+    uint64_t id[2] = {source, (uint64_t)n};
+    uint64_t key = ar_hash64(id, sizeof(id), cache->config_key);
+    return key ? key : 1;
+}
+
+static void pack_frame(const ar_plan_t* plan, uint8_t* packed, const uint8_t* const* src, const int* src_pitch)
+{
+    for (int i = 0; i < plan->out_plane; i++) {
+        int row_size = plan->out_width[i] * plan->out_bytes_per_pixel[i];
+        int height = plan->out_height[i];
+        copy_plane(packed, row_size, src[i], src_pitch[i], row_size, height);
+        packed += (size_t)row_size * height;
+    }
+}
+
+static void unpack_frame(const ar_plan_t* plan, const uint8_t* packed, uint8_t* const* dst, const int* dst_pitch)
+{
+    for (int i = 0; i < plan->out_plane; i++) {
+        int row_size = plan->out_width[i] * plan->out_bytes_per_pixel[i];
+        int height = plan->out_height[i];
+        copy_plane(dst[i], dst_pitch[i], packed, row_size, row_size, height);
+        packed += (size_t)row_size * height;
+    }
+}
+
+int ar_cache_get(ar_cache_t* cache, uint64_t source, int n, uint8_t* const* dst, const int* dst_pitch,
+                 void* meta, int* meta_size)
+{
+    if (!cache || !dst || !dst_pitch) {
+        return 0;
+    }
+    uint64_t key = cache_key(cache, source, n);
+    int used = (int)get_u32(cache->header + 20);
+    for (int i = 0; i < used; i++) {
+        uint8_t* entry = cache->index + (size_t)i * CACHE_ENTRY_SIZE;
+        if (get_u64(entry) == key) {
+            const uint8_t* slot = cache->data + i * cache->slot_size;
+            unpack_frame(cache->plan, slot, dst, dst_pitch);
+            if (meta_size) {
+                *meta_size = (int)get_u32(slot + cache->frame_size);
+                if (meta) {
+                    memcpy(meta, slot + cache->frame_size + 4, *meta_size);
+                }
+            }
+            put_u64(entry + 8, cache_tick(cache));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int ar_cache_put(ar_cache_t* cache, uint64_t source, int n, const uint8_t* const* src, const int* src_pitch,
+                 const void* meta, int meta_size)
+{
+    if (!cache || !src || !src_pitch || meta_size < 0 || meta_size > AR_CACHE_META_SIZE ||
+        (meta_size && !meta)) {
+        return AR_ERROR_INVALID;
+    }
+    uint64_t key = cache_key(cache, source, n);
+    int used = (int)get_u32(cache->header + 20);
+    int slot = -1;
+    for (int i = 0; i < used && slot < 0; i++) {
+        if (get_u64(cache->index + (size_t)i * CACHE_ENTRY_SIZE) == key) {
+            slot = i;
+        }
+    }
+    if (slot < 0 && used < cache->slots) {
+        slot = used;
+        put_u32(cache->header + 20, used + 1);
+    }
+    if (slot < 0) {
+        uint64_t oldest = 0;
+        for (int i = 0; i < used; i++) {
+            uint64_t last = get_u64(cache->index + (size_t)i * CACHE_ENTRY_SIZE + 8);
+            if (slot < 0 || last < oldest) {
+                slot = i;
+                oldest = last;
+            }
+        }
+    }
+
+    uint8_t* entry = cache->index + (size_t)slot * CACHE_ENTRY_SIZE;
+    put_u64(entry, 0);
+    uint8_t* data = cache->data + slot * cache->slot_size;
+    pack_frame(cache->plan, data, src, src_pitch);
+    put_u32(data + cache->frame_size, (uint32_t)meta_size);
+    if (meta_size) {
+        memcpy(data + cache->frame_size + 4, meta, meta_size);
+    }
+    put_u64(entry + 8, cache_tick(cache));
+    put_u64(entry, key);
+    return AR_OK;
+}
+
+/*
+    large images: the file is mapped, never read as a whole. its pages are
+    handed to a stream one band at a time and released right after, so
+    the mapping does not pile up in memory either. offsets into the file
+    are 64bit; a row and a band of rows are far below 2GB.
+*/
+#define IMAGE_BAND_BYTES (4 << 20)
+
+struct ar_image {
+    mapped_file_t* file;
+    int64_t offset;   /* of row 0 */
+    int width;
+    int height;
+    int format;
+    int row_size;
+};
+
+/* the next header field of a PNM file, skipping whitespace and comments. */
+static bool pnm_field(const uint8_t* data, int64_t size, int64_t* pos, int64_t* value)
+{
+    while (*pos < size) {
+        if (data[*pos] == '#') {
+            while (*pos < size && data[*pos] != '\n') {
+                (*pos)++;
+            }
+        } else if (data[*pos] == ' ' || data[*pos] == '\t' || data[*pos] == '\r' || data[*pos] == '\n') {
+            (*pos)++;
+        } else {
+            break;
+        }
+    }
+    if (*pos == size || data[*pos] < '0' || data[*pos] > '9') {
+        return false;
+    }
+    *value = 0;
+    while (*pos < size && data[*pos] >= '0' && data[*pos] <= '9' && *value < 0x7fffffff) {
+        *value = *value * 10 + (data[*pos] - '0');
+        (*pos)++;
+    }
+    return *value <= 0x7fffffff;
+}
+
+int ar_open_image(const char* path, int format, int width, int height, ar_image_t** image)
+{
+    if (!path || !image) {
+        return AR_ERROR_INVALID;
+    }
+    *image = NULL;
+    if ((width > 0 || height > 0) &&
+        (width < 1 || height < 1 || (format != AR_FORMAT_GRAY && format != AR_FORMAT_RGB24 &&
+                                     format != AR_FORMAT_RGB32))) {
+        return AR_ERROR_INVALID;
+    }
+    ar_image_t* img = (ar_image_t*)calloc(1, sizeof(ar_image_t));
+    if (!img) {
+        return AR_ERROR_NOMEM;
+    }
+    img->file = OpenMappedFile(path, 0, false);
+    if (!img->file) {
+        free(img);
+        return AR_ERROR_INVALID;
+    }
+    const uint8_t* data = MappedData(img->file);
+    int64_t size = MappedSize(img->file);
+
+    if (width > 0) {
+        img->width = width;
+        img->height = height;
+        img->format = format;
+    } else {
+        int64_t pos = 2, w, h, maxval;
+        if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6') ||
+            !pnm_field(data, size, &pos, &w) || !pnm_field(data, size, &pos, &h) ||
+            !pnm_field(data, size, &pos, &maxval) || w < 1 || h < 1 || maxval < 1 || maxval > 255) {
+            ar_close_image(img);
+            return AR_ERROR_UNSUPPORTED;
+        }
+        img->width = (int)w;
+        img->height = (int)h;
+        img->format = data[1] == '5' ? AR_FORMAT_GRAY : AR_FORMAT_RGB24;
+        img->offset = pos + 1;
+    }
+    int bpp = img->format == AR_FORMAT_RGB32 ? 4 : img->format == AR_FORMAT_RGB24 ? 3 : 1;
+    if ((int64_t)img->width * bpp > 0x7fffffff / 2 ||
+        img->offset + (int64_t)img->width * bpp * img->height > size) {
+        ar_close_image(img);
+        return AR_ERROR_INVALID;
+    }
+    img->row_size = img->width * bpp;
+
+    *image = img;
+    return AR_OK;
+}
+
+void ar_close_image(ar_image_t* image)
+{
+    if (!image) {
+        return;
+    }
+    CloseMappedFile(image->file);
+    free(image);
+}
+
+void ar_image_size(const ar_image_t* image, int* width, int* height, int* format)
+{
+    *width = image->width;
+    *height = image->height;
+    *format = image->format;
+}
+
+int ar_resize_image(const ar_plan_t* plan, const ar_image_t* image, uint8_t* const* dst,
+                    const int* dst_pitch, int band_rows)
+{
+    if (!plan || !image || !dst || !dst_pitch || band_rows < 0) {
+        return AR_ERROR_INVALID;
+    }
+    const ar_config_t* config = &plan->config;
+    if (config->src_width != image->width || config->src_height != image->height ||
+        config->format != image->format || config->sample_type != AR_SAMPLE_U8) {
+        return AR_ERROR_INVALID;
+    }
+    if (band_rows == 0) {
+        band_rows = IMAGE_BAND_BYTES / image->row_size;
+    }
+    if (band_rows > 0x7fffffff / image->row_size) {
+        band_rows = 0x7fffffff / image->row_size;
+    }
+    if (band_rows < 1) {
+        band_rows = 1;
+    }
+
+    ar_stream_t* stream;
+    int ret = ar_create_stream(plan, &stream);
+    if (ret != AR_OK) {
+        return ret;
+    }
+    ar_begin_frame(stream, dst, dst_pitch, NULL, NULL);
+    const uint8_t* data = MappedData(image->file);
+    for (int y = 0; y < image->height && ret == AR_OK; y += band_rows) {
+        int rows = band_rows < image->height - y ? band_rows : image->height - y;
+        int64_t offset = image->offset + (int64_t)y * image->row_size;
+        const uint8_t* src = data + offset;
+        ret = ar_push_rows(stream, &src, &image->row_size, rows);
+        ReleaseMappedRange(image->file, offset, (int64_t)rows * image->row_size);
+    }
+    ar_free_stream(stream);
+    return ret;
+}
+
+const char* ar_strerror(int code)
+{
+    switch (code) {
+    case AR_OK:
+        return "success";
+    case AR_ERROR_INVALID:
+        return "invalid argument";
+    case AR_ERROR_UNSUPPORTED:
+        return "unsupported geometry";
+    case AR_ERROR_NOMEM:
+        return "out of memory";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,394 @@
+/*
+    arearesize - area-average downscaler library
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    host independent C interface.
+
+    a plan holds everything that depends only on the geometry (per-plane
+    params and weight tables). it is never written after ar_create_plan(),
+    so one plan can be shared by any number of threads.
+
+    a scratch holds the intermediate buffers of one resize. use one scratch
+    per thread, or pass NULL to let ar_resize() allocate a temporary one.
+*/
+
+#ifndef AREARESIZE_H
+#define AREARESIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AR_VERSION "0.2.0"
+
+enum {
+    AR_OK                =  0,
+    AR_ERROR_INVALID     = -1,  /* bad config or arguments */
+    AR_ERROR_UNSUPPORTED = -2,  /* upscale or subsampling mismatch */
+    AR_ERROR_NOMEM       = -3
+};
+
+enum {
+    AR_FORMAT_GRAY,   /* 1 plane */
+    AR_FORMAT_YUV,    /* 3 planes, U and V are subsampled */
+    AR_FORMAT_RGBP,   /* 3 planes, no subsampling */
+    AR_FORMAT_RGB24,  /* packed BGR, 1 plane */
+    AR_FORMAT_RGB32,  /* packed BGRA, 1 plane */
+    AR_FORMAT_NV12,   /* output only: Y plane and interleaved UV plane, 8bit */
+    AR_FORMAT_P010,   /* output only: the same in 16bit words, 10bit in the high bits */
+    AR_FORMAT_P016    /* output only: the same, 16bit */
+};
+
+enum {
+    AR_SAMPLE_U8,     /* 8bit integer */
+    AR_SAMPLE_FLOAT   /* 32bit float, planar formats only */
+};
+
+/*
+    which axis is resized first. 8bit planes keep full sums between the
+    passes and round once at the end, so the output is the same either way;
+    only the speed differs. AUTO picks, per plane, the order that does less
+    work. float and premultiplied plans always go horizontal first.
+*/
+enum {
+    AR_ORDER_AUTO,
+    AR_ORDER_HORIZONTAL_FIRST,
+    AR_ORDER_VERTICAL_FIRST
+};
+
+/* RGB to YUV matrix for output_format, see below. */
+enum {
+    AR_MATRIX_BT601,
+    AR_MATRIX_BT709
+};
+
+#define AR_MAX_PLANES 4
+
+typedef struct {
+    int src_width;
+    int src_height;
+    int target_width;
+    int target_height;
+    int format;       /* AR_FORMAT_* */
+    int subsample_h;  /* chroma divisor for AR_FORMAT_YUV: 1, 2 or 4 */
+    int subsample_v;
+    int sample_type;  /* AR_SAMPLE_*, ar_init_config() sets AR_SAMPLE_U8 */
+    int premultiplied; /* AR_FORMAT_RGB32 only: weight color by alpha, see below */
+    int order;        /* AR_ORDER_*, ar_init_config() sets AR_ORDER_AUTO */
+    int output_format; /* ar_init_config() sets format, see below */
+    int output_subsample_h; /* ar_init_config() sets subsample_h/v, see below */
+    int output_subsample_v;
+    int matrix;       /* AR_MATRIX_*, for RGB to YUV */
+    int full_range;   /* RGB to YUV: 0 gives 16-235/16-240, 1 gives 0-255 */
+    int alpha;        /* GRAY/YUV/RGBP: 1 adds a full size alpha plane, see below */
+} ar_config_t;
+
+/*
+    premultiplied: color is averaged weighted by alpha, so transparent
+    pixels do not darken the edges of what is around them. input and
+    output are both straight (not premultiplied) BGRA. color is the exact
+    sum of color * alpha divided by the sum of alpha, rounded to nearest,
+    so it keeps its precision at low alpha; alpha is truncated like in the
+    plain mode. on fully opaque areas color can be 1 above the plain mode,
+    which truncates. tensor output is not available in this mode.
+*/
+
+/*
+    alpha: the planes are followed by one more plane at the full (luma)
+    size, for YUVA, planar RGBA or gray + alpha sources. it is resized like
+    any other plane, with its own pipeline, so it goes through the same
+    planar kernels as luma; color is not weighted by it (premultiplied is
+    for packed RGB32 only). not with NV12/P010/P016 output.
+*/
+
+/*
+    output_format: AR_FORMAT_RGB24/RGB32 sources may be written as
+    AR_FORMAT_YUV with output_subsample_h/v, converted with 'matrix' while
+    they are averaged. luma is the average of each output pixel and chroma
+    the average over the whole output_subsample_h x output_subsample_v
+    block, so there is no intermediate RGB frame and no second resample.
+    such a plan takes 1 source plane and writes 3; ar_plane_count() and
+    ar_plane_size() describe the output. 8bit only, not with premultiplied;
+    regions, streams and tensors are not available.
+
+    output_subsample_h/v of an AR_FORMAT_YUV plan may also differ from
+    subsample_h/v: the chroma planes are then averaged straight from the
+    source chroma size to the target chroma size (4:4:4 to 4:2:0 for
+    example). the target chroma must not be larger than the source chroma.
+
+    AR_FORMAT_NV12/P010/P016 output of an AR_FORMAT_YUV 8bit plan writes 2
+    planes: luma, then U and V interleaved (UVUV...), which the chroma pass
+    produces together; output_subsample_h/v choose between NV12 (2x2), NV16
+    (2x1) and so on. ar_plane_size() of the UV plane counts UV pairs.
+    P010/P016 hold the average rounded to 10 or 16 bits instead of the
+    truncated 8bit value, shifted to the top of each native 16bit word
+    (0..255 maps to 0..1023 << 6 or 0..65535). the source is still 3
+    planes. regions, streams and tensors are not available.
+*/
+
+typedef struct ar_plan ar_plan_t;
+typedef struct ar_scratch ar_scratch_t;
+
+void ar_init_config(ar_config_t* config, int src_width, int src_height,
+                    int target_width, int target_height, int format,
+                    int subsample_h, int subsample_v);
+
+int ar_create_plan(const ar_config_t* config, ar_plan_t** plan);
+void ar_free_plan(ar_plan_t* plan);
+
+int ar_plane_count(const ar_plan_t* plan);
+/* size of the output plane in pixels. */
+void ar_plane_size(const ar_plan_t* plan, int plane, int* width, int* height);
+
+ar_scratch_t* ar_create_scratch(const ar_plan_t* plan);
+void ar_free_scratch(ar_scratch_t* scratch);
+
+/*
+    src/dst/pitch arrays have ar_plane_count() entries (src has 1 when
+    converting RGB to YUV). pitches are in bytes and may be negative. with
+    AR_SAMPLE_FLOAT the planes hold floats and are not rounded at any
+    stage.
+*/
+int ar_resize(const ar_plan_t* plan, ar_scratch_t* scratch,
+              const uint8_t* const* src, const int* src_pitch,
+              uint8_t* const* dst, const int* dst_pitch);
+
+/*
+    resize 'count' frames of the same geometry. src[f * planes + p] and
+    dst[f * planes + p] are plane p of frame f; pitches are shared by all
+    frames. planes are processed one at a time over all frames, so each
+    plane's tables stay in cache for the whole batch.
+*/
+int ar_resize_batch(const ar_plan_t* plan, ar_scratch_t* scratch, int count,
+                    const uint8_t* const* src, const int* src_pitch,
+                    uint8_t* const* dst, const int* dst_pitch);
+
+/*
+    partial resize for callers that know which parts of the source changed.
+    ar_source_region() gives the source rectangle that the output rectangle
+    (x, y, width, height) of a plane is computed from. ar_resize_region()
+    recomputes only that output rectangle; src/dst point at the top-left of
+    the whole plane and every other output pixel is left untouched. a
+    scratch is required.
+*/
+int ar_source_region(const ar_plan_t* plan, int plane, int x, int y, int width, int height,
+                     int* src_x, int* src_y, int* src_width, int* src_height);
+int ar_resize_region(const ar_plan_t* plan, ar_scratch_t* scratch, int plane,
+                     const uint8_t* src, int src_pitch, uint8_t* dst, int dst_pitch,
+                     int x, int y, int width, int height);
+
+/*
+    row streaming, for callers that receive the source a band at a time
+    (capture, decoding) and want output rows as early as possible.
+    ar_begin_frame() sets the destination planes; each ar_push_rows() takes
+    the next 'rows' rows of plane 0 (rows / subsample_v of the chroma
+    planes, so rows must be a multiple of subsample_v for YUV, and all
+    'rows' of an alpha plane), with src pointing at the first row of the
+    band in every plane. as soon as the source window of an output row is
+    complete, that row is written to dst and func(user, plane, y, height)
+    reports the band of plane rows that became ready. bands are reported
+    in order per plane, and the last push of a frame completes all of
+    them. a stream keeps the intermediate rows that pending output rows
+    still need (about one band plus the height of one output row's
+    window), so a source band may be discarded once pushed and the source
+    height does not matter for memory.
+    one stream serves one frame at a time and is not thread safe; the plan
+    can still be shared.
+*/
+typedef struct ar_stream ar_stream_t;
+typedef void (*ar_rows_func_t)(void* user, int plane, int y, int height);
+
+int ar_create_stream(const ar_plan_t* plan, ar_stream_t** stream);
+void ar_free_stream(ar_stream_t* stream);
+int ar_begin_frame(ar_stream_t* stream, uint8_t* const* dst, const int* dst_pitch,
+                   ar_rows_func_t func, void* user);
+int ar_push_rows(ar_stream_t* stream, const uint8_t* const* src, const int* src_pitch, int rows);
+
+/*
+    large images (scans, panoramas) that are not worth loading whole.
+    ar_open_image() maps a binary PGM (P5) or PPM (P6) file with maxval up
+    to 255 or, when width and height are given, a headerless file of
+    width x height pixels of AR_FORMAT_GRAY, RGB24 or RGB32. nothing is
+    read up front. ar_image_size() gives the geometry and the format for
+    ar_init_config(); PPM keeps the file's RGB order, which averaging
+    does not care about.
+
+    ar_resize_image() streams the image through a stream of this plan in
+    bands of band_rows rows (0 picks about 4MB) and lets the system drop
+    every band from memory once it is pushed, so the peak is about one
+    band of source, the intermediate rows of one output row and dst. an
+    image larger than the address space needs a 64bit build.
+*/
+typedef struct ar_image ar_image_t;
+
+int ar_open_image(const char* path, int format, int width, int height, ar_image_t** image);
+void ar_close_image(ar_image_t* image);
+void ar_image_size(const ar_image_t* image, int* width, int* height, int* format);
+int ar_resize_image(const ar_plan_t* plan, const ar_image_t* image, uint8_t* const* dst,
+                    const int* dst_pitch, int band_rows);
+
+/*
+    tensor output: the last stage of the resize writes planar float32 or
+    float16 channels (CHW) instead of 8bit pixels, folding a per-channel
+    scale and bias into the final divide:
+
+        out = average * scale[c] + bias[c]    (average is in 0..255)
+
+    mean/std normalization is scale = 1 / (255 * std), bias = -mean / std.
+    packed formats are split into channels; order[] picks the source
+    channel of each output channel (e.g. {2, 1, 0} turns BGR into RGB, and
+    channels = 3 drops the alpha of RGB32). planar formats need all planes
+    to have the same size (GRAY, RGBP, 4:4:4 YUV) and use one channel per
+    plane. 8bit plans only.
+*/
+enum {
+    AR_TENSOR_FLOAT32,
+    AR_TENSOR_FLOAT16
+};
+
+typedef struct {
+    int type;        /* AR_TENSOR_* */
+    int channels;    /* number of output channels, 0 for all of them */
+    int order[4];
+    float scale[4];
+    float bias[4];
+} ar_tensor_t;
+
+/* identity order, all channels, scale 1/255 and bias 0 (values in 0..1). */
+void ar_init_tensor(ar_tensor_t* tensor, int type);
+
+/* dst receives channels * target_height * target_width elements. */
+int ar_resize_tensor(const ar_plan_t* plan, ar_scratch_t* scratch, const ar_tensor_t* tensor,
+                     const uint8_t* const* src, const int* src_pitch, void* dst);
+
+/* frame f is written at dst + f * channels * target_height * target_width (NCHW). */
+int ar_resize_tensor_batch(const ar_plan_t* plan, ar_scratch_t* scratch, const ar_tensor_t* tensor,
+                           int count, const uint8_t* const* src, const int* src_pitch, void* dst);
+
+/*
+    temporal averaging, for frame rate reductions: the output rate is
+    num / den times the source rate (num <= den). output frame n is the
+    area average over the source frames it overlaps in time, each weighted
+    by the overlap, with the same exact integer scheme as the two spatial
+    axes: ar_temporal_sources() gives those frames, and src of
+    ar_resize_temporal() holds their planes in order, like
+    ar_resize_batch(). 1 / 2 averages pairs of frames, 2 / 5 turns 60fps
+    into 24fps with weights 2, 2, 1 | 1, 2, 2. a temporal object holds
+    frame sized sums, so use one per thread. 8bit plans without
+    premultiplied or output conversion.
+*/
+typedef struct ar_temporal ar_temporal_t;
+
+int ar_create_temporal(const ar_plan_t* plan, int num, int den, ar_temporal_t** temporal);
+void ar_free_temporal(ar_temporal_t* temporal);
+/* output frames that are covered completely by src_frames source frames. */
+int ar_temporal_frames(const ar_temporal_t* temporal, int src_frames);
+void ar_temporal_sources(const ar_temporal_t* temporal, int n, int* first, int* count);
+int ar_resize_temporal(ar_temporal_t* temporal, int n, const uint8_t* const* src, const int* src_pitch,
+                       uint8_t* const* dst, const int* dst_pitch);
+
+/*
+    times both pass orders on a synthetic frame of this geometry and sets
+    config->order to the faster one. the result is cached in cache_path,
+    keyed by library version, cpu model, format and sizes, so it is measured
+    once per machine. NULL uses %LOCALAPPDATA%\arearesize_tune.txt on
+    windows and $XDG_CACHE_HOME (or ~/.cache)/arearesize_tune.txt
+    elsewhere. does nothing when config->order is already set or when
+    there is nothing to choose (float, premultiplied, one axis resized).
+    an unwritable cache only costs the measurement on the next call.
+*/
+int ar_autotune(ar_config_t* config, const char* cache_path);
+
+/*
+    luma thumbnails for scene analysis: a width x height downscale of the
+    luma of every frame, kept in a memory-mapped file indexed by frame
+    number, so other tools can read any frame's thumbnail without decoding.
+    ar_write_thumb() takes the source luma plane of frame n, luma_width x
+    luma_height, and area averages it with a single rounding like
+    ar_resize(); frames may be written in any order and from several
+    threads. after ar_thumbs_temporal(), thumbnail n averages the luma
+    planes of the source frames ar_temporal_sources() gives for num/den,
+    written with ar_write_thumb_temporal() one frame at a time. a file
+    with the same width, height and frames is reused with the thumbnails
+    it already holds, so remove it when the source changes.
+
+    file layout, integers little endian:
+        0       "ARTHUMB1"
+        8       uint32 width, height, frames
+        32      frames bytes, nonzero once the frame has been written,
+                padded to a multiple of 16
+        after   frames * width * height bytes, frame n at n * width * height
+*/
+typedef struct ar_thumbs ar_thumbs_t;
+
+int ar_open_thumbs(const char* path, int frames, int luma_width, int luma_height,
+                   int width, int height, ar_thumbs_t** thumbs);
+void ar_close_thumbs(ar_thumbs_t* thumbs);
+int ar_write_thumb(ar_thumbs_t* thumbs, int n, const uint8_t* luma, int pitch);
+int ar_thumbs_temporal(ar_thumbs_t* thumbs, int num, int den);
+int ar_write_thumb_temporal(ar_thumbs_t* thumbs, int n, const uint8_t* const* luma, int pitch);
+/* NULL until frame n is written. */
+const uint8_t* ar_thumb(const ar_thumbs_t* thumbs, int n);
+
+/*
+    persistent cache of resized frames, for scripts that are reloaded
+    often. the file holds as many frames of the plan's output as fit into
+    max_bytes, in fixed slots behind a small index: new frames are
+    appended until it is full, then the least recently used frame is
+    replaced. a frame is keyed by the source id, the frame number and the
+    output geometry and format of the plan. a file made for another frame
+    size or limit is cleared. calls on one cache must not overlap, and
+    only one process may use a file at a time.
+
+    source identifies the source clip; hashing its file name and
+    properties with ar_hash64() is enough.
+
+    meta is stored with the frame and handed back by ar_cache_get(), for
+    what the host keeps next to the pixels (frame properties). it is at
+    most AR_CACHE_META_SIZE bytes; a slot always reserves that much. pass
+    NULL and 0 when there is nothing to keep. ar_cache_get() sets
+    *meta_size and copies the bytes into meta when it is not NULL, which
+    then needs room for AR_CACHE_META_SIZE bytes.
+*/
+#define AR_CACHE_META_SIZE 4096
+
+typedef struct ar_cache ar_cache_t;
+
+int ar_open_cache(const char* path, const ar_plan_t* plan, int64_t max_bytes, ar_cache_t** cache);
+void ar_close_cache(ar_cache_t* cache);
+/* returns 1 and copies frame n into dst when it is cached, 0 otherwise. */
+int ar_cache_get(ar_cache_t* cache, uint64_t source, int n, uint8_t* const* dst, const int* dst_pitch,
+                 void* meta, int* meta_size);
+int ar_cache_put(ar_cache_t* cache, uint64_t source, int n, const uint8_t* const* src, const int* src_pitch,
+                 const void* meta, int meta_size);
+
+/* FNV-1a. */
+uint64_t ar_hash64(const void* data, size_t size, uint64_t seed);
+
+const char* ar_strerror(int code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
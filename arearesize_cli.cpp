@@ -0,0 +1,760 @@
+/*
+    arearesize - YUV4MPEG2 streaming area-average downscaler
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    decoder | arearesize 640x360 | encoder
+
+    three stages connected by bounded lock-free queues:
+        reader  : stdin -> free frame slot -> work queue
+        workers : work queue -> ar_resize() -> done queue
+        writer  : done queue -> reorder by frame number -> stdout -> free queue
+    all frame buffers are allocated once up front and recycled through the
+    free queue. stdin/stdout are accessed with plain read(2)/write(2) in
+    whole frames, without stdio buffering.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "arearesize.h"
+
+#define CLI_NAME "arearesize"
+#define READ_CHUNK (1 << 20)
+
+/* Dmitry Vyukov's bounded MPMC queue. capacity must be a power of 2. */
+template <typename T>
+class bounded_queue {
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    cell_t* buffer;
+    size_t mask;
+    char pad0[64];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[64];
+    std::atomic<size_t> dequeue_pos;
+
+public:
+    explicit bounded_queue(size_t capacity) : buffer(new cell_t[capacity]), mask(capacity - 1)
+    {
+        for (size_t i = 0; i < capacity; i++) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    ~bounded_queue() { delete[] buffer; }
+
+    bool try_push(const T& data)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell_t* cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell->data = data;
+                    cell->sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& data)
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell_t* cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    data = cell->data;
+                    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+static std::atomic<bool> failed(false);
+
+/* spin a little, then yield, then sleep. returns false once the run failed. */
+static bool backoff(int& count)
+{
+    if (failed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (++count < 64) {
+        return true;
+    }
+    if (count < 256) {
+        std::this_thread::yield();
+    } else {
+        usleep(100);
+    }
+    return true;
+}
+
+template <typename T>
+static bool push(bounded_queue<T>& queue, const T& data)
+{
+    for (int count = 0; !queue.try_push(data);) {
+        if (!backoff(count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static bool pop(bounded_queue<T>& queue, T& data)
+{
+    for (int count = 0; !queue.try_pop(data);) {
+        if (!backoff(count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fail(const char* fmt, const char* arg)
+{
+    fprintf(stderr, CLI_NAME ": ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    failed.store(true);
+}
+
+typedef struct {
+    int width;
+    int height;
+    int format;
+    int subsample_h;
+    int subsample_v;
+    int alpha;         /* 444alpha: a full size alpha plane follows V */
+    int aspect_num;    /* pixel aspect ratio of the A tag, 0:0 when unknown */
+    int aspect_den;
+    std::string tags;  /* header tags other than W and H, passed through */
+} y4m_info_t;
+
+typedef struct {
+    long long number;
+    uint8_t* src;      /* planes as read from stdin */
+    uint8_t* out;      /* "FRAME\n" followed by the resized planes */
+} slot_t;
+
+static const char frame_header[] = "FRAME\n";
+static const int frame_header_size = sizeof(frame_header) - 1;
+
+/* stdin is read in large chunks; frame data bypasses this buffer. */
+typedef struct {
+    uint8_t* data;
+    size_t pos;
+    size_t len;
+} input_t;
+
+static ssize_t read_fd(int fd, void* buf, size_t size)
+{
+    ssize_t ret;
+    do {
+        ret = read(fd, buf, size);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+static bool write_all(int fd, const uint8_t* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t ret = write(fd, buf, size);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+/* returns false on EOF before any byte of the line. */
+static bool read_line(input_t* in, std::string& line)
+{
+    line.clear();
+    for (;;) {
+        if (in->pos == in->len) {
+            ssize_t ret = read_fd(0, in->data, READ_CHUNK);
+            if (ret <= 0) {
+                return !line.empty();
+            }
+            in->pos = 0;
+            in->len = ret;
+        }
+        uint8_t* p = in->data + in->pos;
+        uint8_t* nl = (uint8_t*)memchr(p, '\n', in->len - in->pos);
+        size_t n = nl ? nl - p : in->len - in->pos;
+        line.append((const char*)p, n);
+        in->pos += n;
+        if (nl) {
+            in->pos++;
+            return true;
+        }
+        if (line.size() > 4096) {
+            return false;
+        }
+    }
+}
+
+/* drain what is left in the chunk buffer, then read straight into dst. */
+static bool read_exact(input_t* in, uint8_t* dst, size_t size)
+{
+    size_t n = in->len - in->pos;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(dst, in->data + in->pos, n);
+    in->pos += n;
+    dst += n;
+    size -= n;
+    while (size > 0) {
+        ssize_t ret = read_fd(0, dst, size);
+        if (ret <= 0) {
+            return false;
+        }
+        dst += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+static bool parse_colorspace(const char* cs, y4m_info_t* info)
+{
+    info->format = AR_FORMAT_YUV;
+    info->subsample_h = info->subsample_v = 1;
+    info->alpha = 0;
+    if (!strncmp(cs, "420", 3) && (!cs[3] || !strcmp(cs + 3, "jpeg") ||
+        !strcmp(cs + 3, "mpeg2") || !strcmp(cs + 3, "paldv"))) {
+        info->subsample_h = info->subsample_v = 2;
+    } else if (!strcmp(cs, "422")) {
+        info->subsample_h = 2;
+    } else if (!strcmp(cs, "411")) {
+        info->subsample_h = 4;
+    } else if (!strcmp(cs, "mono")) {
+        info->format = AR_FORMAT_GRAY;
+    } else if (!strcmp(cs, "444alpha")) {
+        info->alpha = 1;
+    } else if (strcmp(cs, "444")) {
+        return false;
+    }
+    return true;
+}
+
+static bool parse_header(const std::string& line, y4m_info_t* info)
+{
+    if (line.compare(0, 10, "YUV4MPEG2 ")) {
+        return false;
+    }
+    info->width = info->height = 0;
+    info->aspect_num = info->aspect_den = 0;
+    parse_colorspace("420jpeg", info);
+
+    size_t pos = 10;
+    while (pos < line.size()) {
+        size_t end = line.find(' ', pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        std::string tag = line.substr(pos, end - pos);
+        pos = end + 1;
+        if (tag.empty()) {
+            continue;
+        }
+        if (tag[0] == 'W') {
+            info->width = atoi(tag.c_str() + 1);
+            continue;
+        }
+        if (tag[0] == 'H') {
+            info->height = atoi(tag.c_str() + 1);
+            continue;
+        }
+        if (tag[0] == 'A') {
+            /* rewritten for the new size, see output_aspect(). */
+            if (sscanf(tag.c_str() + 1, "%d:%d", &info->aspect_num, &info->aspect_den) != 2 ||
+                info->aspect_num < 0 || info->aspect_den < 0) {
+                info->aspect_num = info->aspect_den = 0;
+            }
+            continue;
+        }
+        if (tag[0] == 'C' && !parse_colorspace(tag.c_str() + 1, info)) {
+            fail("unsupported colorspace '%s'.", tag.c_str() + 1);
+            return false;
+        }
+        info->tags += ' ';
+        info->tags += tag;
+    }
+    return info->width > 0 && info->height > 0;
+}
+
+static long long gcd64(long long x, long long y)
+{
+    return y ? gcd64(y, x % y) : x;
+}
+
+/*
+    the pixel aspect ratio that keeps the display aspect ratio after
+    scaling width x height to target_width x target_height.
+*/
+static void output_aspect(const y4m_info_t* info, int target_width, int target_height, int* num, int* den)
+{
+    *num = *den = 0;
+    if (info->aspect_num < 1 || info->aspect_den < 1) {
+        return;
+    }
+    long long n = (long long)info->aspect_num * info->width * target_height;
+    long long d = (long long)info->aspect_den * info->height * target_width;
+    long long g = gcd64(n, d);
+    n /= g;
+    d /= g;
+    while (n > INT_MAX || d > INT_MAX) {
+        n = (n + 1) >> 1;
+        d = (d + 1) >> 1;
+    }
+    *num = (int)n;
+    *den = (int)d;
+}
+
+typedef struct {
+    const ar_plan_t* plan;
+    int num_plane;
+    int num_dst_plane;
+    int src_width[AR_MAX_PLANES];
+    int src_height[AR_MAX_PLANES];
+    int dst_row_size[AR_MAX_PLANES];
+    int dst_height[AR_MAX_PLANES];
+    int skip;          /* bytes of "FRAME\n" not written, for raw output */
+    size_t src_size;
+    size_t dst_size;
+    std::vector<slot_t> slots;
+    bounded_queue<int>* free_slots;
+    bounded_queue<int>* work;
+    bounded_queue<int>* done;
+    std::atomic<long long> total;
+    std::atomic<bool> eof;
+} pipeline_t;
+
+static void worker(pipeline_t* pl)
+{
+    ar_scratch_t* scratch = ar_create_scratch(pl->plan);
+    if (!scratch) {
+        fail("%s", "out of memory.");
+        return;
+    }
+
+    const uint8_t* srcp[AR_MAX_PLANES];
+    uint8_t* dstp[AR_MAX_PLANES];
+    int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+    for (int i = 0; i < pl->num_plane; i++) {
+        src_pitch[i] = pl->src_width[i];
+    }
+    for (int i = 0; i < pl->num_dst_plane; i++) {
+        dst_pitch[i] = pl->dst_row_size[i];
+    }
+
+    int index;
+    while (pop(*pl->work, index) && index >= 0) {
+        slot_t* slot = &pl->slots[index];
+        const uint8_t* s = slot->src;
+        uint8_t* d = slot->out + frame_header_size;
+        for (int i = 0; i < pl->num_plane; i++) {
+            srcp[i] = s;
+            s += (size_t)pl->src_width[i] * pl->src_height[i];
+        }
+        for (int i = 0; i < pl->num_dst_plane; i++) {
+            dstp[i] = d;
+            d += (size_t)pl->dst_row_size[i] * pl->dst_height[i];
+        }
+        ar_resize(pl->plan, scratch, srcp, src_pitch, dstp, dst_pitch);
+        if (!push(*pl->done, index)) {
+            break;
+        }
+    }
+
+    ar_free_scratch(scratch);
+}
+
+/*
+    at most slots.size() frames are in flight, so frame n can be parked at
+    n % slots.size() until everything before it has been written.
+*/
+static void writer(pipeline_t* pl)
+{
+    size_t num_slots = pl->slots.size();
+    std::vector<int> pending(num_slots, -1);
+    long long next = 0;
+
+    for (int count = 0;;) {
+        if (pl->eof.load(std::memory_order_acquire) && next == pl->total.load()) {
+            return;
+        }
+        int index;
+        if (!pl->done->try_pop(index)) {
+            if (!backoff(count)) {
+                return;
+            }
+            continue;
+        }
+        count = 0;
+        pending[pl->slots[index].number % num_slots] = index;
+
+        while ((index = pending[next % num_slots]) >= 0) {
+            if (!write_all(1, pl->slots[index].out + pl->skip,
+                           frame_header_size - pl->skip + pl->dst_size)) {
+                fail("write failed: %s", strerror(errno));
+                return;
+            }
+            pending[next % num_slots] = -1;
+            next++;
+            if (!push(*pl->free_slots, index)) {
+                return;
+            }
+        }
+    }
+}
+
+static size_t pow2_ceil(size_t n)
+{
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/*
+    still image mode: the input is mapped and streamed in bands through
+    ar_resize_image(), the output (the only frame-sized buffer) is written
+    as the same kind of file.
+*/
+static int resize_image(const char* input, const char* raw, const char* output,
+                        int target_width, int target_height)
+{
+    int format = AR_FORMAT_GRAY, width = 0, height = 0;
+    if (raw) {
+        char name[16];
+        if (sscanf(raw, "%dx%d:%15s", &width, &height, name) != 3 ||
+            (strcmp(name, "gray") && strcmp(name, "rgb24") && strcmp(name, "rgb32"))) {
+            fail("bad raw format '%s'.", raw);
+            return 1;
+        }
+        format = !strcmp(name, "rgb32") ? AR_FORMAT_RGB32 :
+                 !strcmp(name, "rgb24") ? AR_FORMAT_RGB24 : AR_FORMAT_GRAY;
+    }
+
+    ar_image_t* image;
+    int ret = ar_open_image(input, format, width, height, &image);
+    if (ret != AR_OK) {
+        fail("cannot open %s as an image.", input);
+        return 1;
+    }
+    ar_image_size(image, &width, &height, &format);
+
+    ar_config_t config;
+    ar_plan_t* plan;
+    ar_init_config(&config, width, height, target_width, target_height, format, 1, 1);
+    ret = ar_create_plan(&config, &plan);
+    if (ret != AR_OK) {
+        ar_close_image(image);
+        fail("%s.", ret == AR_ERROR_UNSUPPORTED ? "target must be smaller than the source" :
+                                                  ar_strerror(ret));
+        return 1;
+    }
+
+    int bpp = format == AR_FORMAT_RGB32 ? 4 : format == AR_FORMAT_RGB24 ? 3 : 1;
+    int pitch = target_width * bpp;
+    std::vector<uint8_t> dst((size_t)pitch * target_height);
+    uint8_t* dstp = &dst[0];
+    ret = ar_resize_image(plan, image, &dstp, &pitch, 0);
+    ar_free_plan(plan);
+    ar_close_image(image);
+    if (ret != AR_OK) {
+        fail("%s.", ar_strerror(ret));
+        return 1;
+    }
+
+    int fd = 1;
+    if (output && (fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        fail("cannot create %s.", output);
+        return 1;
+    }
+    char header[64];
+    int header_size = raw ? 0 : snprintf(header, sizeof(header), "P%c\n%d %d\n255\n",
+                                         format == AR_FORMAT_GRAY ? '5' : '6',
+                                         target_width, target_height);
+    bool ok = write_all(fd, (const uint8_t*)header, header_size) && write_all(fd, dstp, dst.size());
+    if (!ok) {
+        fail("write failed: %s", strerror(errno));
+    }
+    if (output) {
+        close(fd);
+    }
+    return ok ? 0 : 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: " CLI_NAME " WIDTHxHEIGHT [-t threads] [-c colorspace] [-f format] < in.y4m > out.y4m\n"
+            "  reads YUV4MPEG2 (420/422/444/411/444alpha/mono, 8bit) on stdin and\n"
+            "  writes the area-average downscaled stream on stdout.\n"
+            "  -t  number of resize threads (default: number of cpus)\n"
+            "  -c  output chroma subsampling (420/422/444/411), resampled from the\n"
+            "      source chroma in the same pass (default: same as the input)\n"
+            "  -f  nv12/p010/p016: write raw frames of Y and interleaved UV planes\n"
+            "      (8bit, 10bit or 16bit in 16bit words) instead of YUV4MPEG2\n"
+            "\n"
+            "       " CLI_NAME " WIDTHxHEIGHT -i image [-r WxH:gray|rgb24|rgb32] [-o output]\n"
+            "  downscales one PGM/PPM (or, with -r, headerless) image of any size,\n"
+            "  streaming it from a memory mapping, into the same kind of file.\n");
+}
+
+int main(int argc, char** argv)
+{
+    int target_width = 0, target_height = 0;
+    int threads = (int)std::thread::hardware_concurrency();
+    const char* colorspace = NULL;
+    int output_format = -1;
+    const char* image = NULL;
+    const char* raw = NULL;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            colorspace = argv[++i];
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            image = argv[++i];
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            raw = argv[++i];
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            i++;
+            output_format = !strcmp(argv[i], "nv12") ? AR_FORMAT_NV12 :
+                            !strcmp(argv[i], "p010") ? AR_FORMAT_P010 :
+                            !strcmp(argv[i], "p016") ? AR_FORMAT_P016 : -2;
+            if (output_format == -2) {
+                usage();
+                return 2;
+            }
+        } else if (sscanf(argv[i], "%dx%d", &target_width, &target_height) != 2) {
+            usage();
+            return 2;
+        }
+    }
+    if (target_width < 1 || target_height < 1) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (image) {
+        return resize_image(image, raw, output, target_width, target_height);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    input_t in;
+    in.data = (uint8_t*)malloc(READ_CHUNK);
+    in.pos = in.len = 0;
+    if (!in.data) {
+        fail("%s", "out of memory.");
+        return 1;
+    }
+
+    std::string line;
+    y4m_info_t info;
+    if (!read_line(&in, line) || !parse_header(line, &info)) {
+        if (!failed) {
+            fail("%s", "stdin is not a YUV4MPEG2 stream.");
+        }
+        return 1;
+    }
+
+    ar_config_t config;
+    ar_plan_t* plan;
+    ar_init_config(&config, info.width, info.height, target_width, target_height,
+                   info.format, info.subsample_h, info.subsample_v);
+    if (colorspace) {
+        y4m_info_t out;
+        if (!parse_colorspace(colorspace, &out) || out.format != info.format || out.alpha != info.alpha) {
+            fail("cannot write colorspace '%s' from this stream.", colorspace);
+            return 1;
+        }
+        config.output_subsample_h = out.subsample_h;
+        config.output_subsample_v = out.subsample_v;
+        /* the C tag is the only one that changes. */
+        size_t pos = info.tags.find(" C");
+        if (pos != std::string::npos) {
+            size_t end = info.tags.find(' ', pos + 1);
+            info.tags.erase(pos, end == std::string::npos ? std::string::npos : end - pos);
+        }
+        info.tags += std::string(" C") + colorspace;
+    }
+    config.alpha = info.alpha;
+    if (output_format >= 0) {
+        config.output_format = output_format;
+    }
+    int ret = ar_create_plan(&config, &plan);
+    if (ret != AR_OK) {
+        fail("%s.", ret == AR_ERROR_UNSUPPORTED ?
+             "target must be smaller than the source and match its chroma subsampling" :
+             ar_strerror(ret));
+        return 1;
+    }
+
+    pipeline_t pl;
+    pl.plan = plan;
+    pl.num_plane = (info.format == AR_FORMAT_GRAY ? 1 : 3) + info.alpha;
+    pl.num_dst_plane = ar_plane_count(plan);
+    pl.skip = output_format >= 0 ? frame_header_size : 0;
+    pl.src_size = pl.dst_size = 0;
+    for (int i = 0; i < pl.num_plane; i++) {
+        /* chroma is subsampled, luma and alpha are not. */
+        bool chroma = i == 1 || i == 2;
+        pl.src_width[i] = chroma ? info.width / info.subsample_h : info.width;
+        pl.src_height[i] = chroma ? info.height / info.subsample_v : info.height;
+        pl.src_size += (size_t)pl.src_width[i] * pl.src_height[i];
+    }
+    for (int i = 0; i < pl.num_dst_plane; i++) {
+        int width;
+        ar_plane_size(plan, i, &width, &pl.dst_height[i]);
+        /* samples per pixel (2 for a UV plane) and bytes per sample. */
+        pl.dst_row_size[i] = width * (output_format >= 0 && i ? 2 : 1) *
+                             (output_format == AR_FORMAT_P010 || output_format == AR_FORMAT_P016 ? 2 : 1);
+        pl.dst_size += (size_t)pl.dst_row_size[i] * pl.dst_height[i];
+    }
+
+    size_t num_slots = threads * 2 + 2;
+    size_t capacity = pow2_ceil(num_slots + threads);
+    pl.slots.resize(num_slots);
+    for (size_t i = 0; i < num_slots; i++) {
+        pl.slots[i].src = (uint8_t*)malloc(pl.src_size);
+        pl.slots[i].out = (uint8_t*)malloc(frame_header_size + pl.dst_size);
+        if (!pl.slots[i].src || !pl.slots[i].out) {
+            fail("%s", "out of memory.");
+            return 1;
+        }
+        memcpy(pl.slots[i].out, frame_header, frame_header_size);
+    }
+    pl.free_slots = new bounded_queue<int>(capacity);
+    pl.work = new bounded_queue<int>(capacity);
+    pl.done = new bounded_queue<int>(capacity);
+    pl.total.store(0);
+    pl.eof.store(false);
+    for (size_t i = 0; i < num_slots; i++) {
+        pl.free_slots->try_push((int)i);
+    }
+
+    char header[96];
+    int aspect_num, aspect_den;
+    output_aspect(&info, target_width, target_height, &aspect_num, &aspect_den);
+    snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d A%d:%d", target_width, target_height,
+             aspect_num, aspect_den);
+    std::string out_header = header + info.tags + "\n";
+    if (output_format < 0 && !write_all(1, (const uint8_t*)out_header.data(), out_header.size())) {
+        fail("write failed: %s", strerror(errno));
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(worker, &pl));
+    }
+    std::thread writer_thread(writer, &pl);
+
+    long long count = 0;
+    while (!failed && read_line(&in, line)) {
+        if (line.compare(0, 5, "FRAME")) {
+            fail("%s", "broken stream, FRAME header expected.");
+            break;
+        }
+        int index;
+        if (!pop(*pl.free_slots, index)) {
+            break;
+        }
+        if (!read_exact(&in, pl.slots[index].src, pl.src_size)) {
+            fprintf(stderr, CLI_NAME ": truncated frame %lld dropped.\n", count);
+            break;
+        }
+        pl.slots[index].number = count++;
+        if (!push(*pl.work, index)) {
+            break;
+        }
+    }
+
+    pl.total.store(count);
+    pl.eof.store(true, std::memory_order_release);
+    for (int i = 0; i < threads; i++) {
+        push(*pl.work, -1);
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+    }
+    writer_thread.join();
+
+    for (size_t i = 0; i < num_slots; i++) {
+        free(pl.slots[i].src);
+        free(pl.slots[i].out);
+    }
+    delete pl.free_slots;
+    delete pl.work;
+    delete pl.done;
+    ar_free_plan(plan);
+    free(in.data);
+
+    return failed ? 1 : 0;
+}
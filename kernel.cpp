@@ -0,0 +1,851 @@
+/*
+    AreaResize.dll
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arearesize.h"
+#include "kernel.h"
+
+typedef struct {
+    BYTE blue;
+    BYTE green;
+    BYTE red;
+    BYTE alpha;
+} rgb32_t;
+
+/*
+    a * b + c. with FMA hardware (-mfma, -march=haswell or later) this is a
+    single fused instruction; without it fmaf() would be a slow library
+    call, so fall back to a plain multiply-add.
+*/
+static inline float madd(float a, float b, float c)
+{
+#if defined(__FMA__) || defined(FP_FAST_FMAF)
+    return fmaf(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+/*
+    what differs between integer and float accumulation: the weight table,
+    the multiply-add and the final store. integer sums are divided by
+    den_h * den_v (den of an axis that keeps its size is 1) only when they
+    are stored as BYTE; an intermediate keeps them whole. float weights are
+    already normalized.
+*/
+template <typename A>
+struct weight_table {
+    typedef int type;
+    static const int* get(const axis_t* axis) { return axis->weight; }
+};
+
+template <>
+struct weight_table<float> {
+    typedef float type;
+    static const float* get(const axis_t* axis) { return axis->fweight; }
+};
+
+template <typename A, typename S, typename W>
+static inline A mac(A acc, S s, W w)
+{
+    return acc + (A)s * w;
+}
+
+static inline float mac(float acc, float s, float w)
+{
+    return madd(s, w, acc);
+}
+
+/*
+    the vertical sum of one output row: value[x] = the sum of s[x] * weight[i]
+    * scale over the taps of rows p, p + src_pitch, ... of S samples. with
+    ADD it is added to value instead of replacing it. every vertical pass
+    goes through here.
+*/
+template <bool ADD, typename S, typename A, typename W>
+static inline void SumRows(A* value, const BYTE* p, int src_pitch, const W* weight, int taps, int row_size,
+                           A scale)
+{
+    int i = 0;
+    if (!ADD) {
+        const S* s = reinterpret_cast<const S*>(p);
+        A w = (A)weight[0] * scale;
+        for (int x = 0; x < row_size; x++) {
+            value[x] = (A)s[x] * w;
+        }
+        p += src_pitch;
+        i = 1;
+    }
+    for (; i < taps; i++, p += src_pitch) {
+        A w = (A)weight[i] * scale;
+        if (w == 0) {
+            continue;
+        }
+        const S* s = reinterpret_cast<const S*>(p);
+        for (int x = 0; x < row_size; x++) {
+            value[x] = mac(value[x], s[x], w);
+        }
+    }
+}
+
+/* value / den, for the values an accumulator of type A can hold. */
+template <typename A>
+struct divisor {
+    A den;
+    divisor(const params_t* params) : den((A)params->den_h * params->den_v) {}
+    A divide(A value) const { return value / den; }
+};
+
+/*
+    a 16bit sum is at most 255 * den with den <= 257, and for those
+    value * ceil(2^24 / den) >> 24 is exact and fits into 32 bits, so the
+    divide turns into a multiply that vectorizes. a FIRST pass, whose den
+    can be larger, never divides.
+*/
+template <>
+struct divisor<uint16_t> {
+    uint32_t magic;
+    divisor(const params_t* params)
+    {
+        double den = (double)params->den_h * params->den_v;
+        magic = den <= 257.0 ? ((1u << 24) + (uint32_t)den - 1) / (uint32_t)den : 0;
+    }
+    uint32_t divide(uint16_t value) const { return (value * magic) >> 24; }
+};
+
+template <typename A, typename DIV>
+static inline void store_sum(BYTE* dstp, A value, const DIV& div)
+{
+    *dstp = (BYTE)div.divide(value);
+}
+
+template <typename A, typename DIV>
+static inline void store_sum(uint16_t* dstp, A value, const DIV& div)
+{
+    *dstp = (uint16_t)value;
+}
+
+template <typename A, typename DIV>
+static inline void store_sum(uint32_t* dstp, A value, const DIV& div)
+{
+    *dstp = (uint32_t)value;
+}
+
+template <typename A, typename DIV>
+static inline void store_sum(uint64_t* dstp, A value, const DIV& div)
+{
+    *dstp = (uint64_t)value;
+}
+
+template <typename DIV>
+static inline void store_sum(float* dstp, float value, const DIV& div)
+{
+    *dstp = value;
+}
+
+template <typename T, typename U>
+struct same_type {
+    enum { value = 0 };
+};
+
+template <typename T>
+struct same_type<T, T> {
+    enum { value = 1 };
+};
+
+/*
+    the exact kernels. a row holds CH interleaved samples per pixel (1 for
+    planar, 3 for BGR, 4 for BGRA). S is the type of the samples read, A
+    the accumulator and D the type written.
+
+    8bit planes run a FIRST pass that writes the weighted sums to a
+    uint16_t or uint32_t intermediate without dividing, and a second pass
+    that divides, so the output is rounded only once and does not depend
+    on which axis went first. float planes are never rounded.
+*/
+template <bool HORIZONTAL, int CH, typename S, typename A, typename D, bool FIRST>
+struct Kernel;
+
+template <int CH, typename S, typename A, typename D, bool FIRST>
+struct Kernel<true, CH, S, A, D, FIRST> {
+    static void Run(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, const params_t* params, void* buff)
+    {
+        typedef typename weight_table<A>::type W;
+        int height = FIRST ? params->src_height : params->target_height;
+        int target_width = params->target_width;
+        int taps = params->axis_h.taps;
+        const int* start = params->axis_h.start;
+        divisor<A> den(params);
+
+        for (int y = 0; y < height; y++) {
+            const S* s = reinterpret_cast<const S*>(srcp);
+            D* d = reinterpret_cast<D*>(dstp);
+            const W* weight = weight_table<A>::get(&params->axis_h);
+            for (int x = 0; x < target_width; x++) {
+                const S* p = s + start[x] * CH;
+                A value[CH] = {0};
+                for (int i = 0; i < taps; i++) {
+                    for (int c = 0; c < CH; c++) {
+                        value[c] = mac(value[c], p[i * CH + c], weight[i]);
+                    }
+                }
+                for (int c = 0; c < CH; c++) {
+                    store_sum(d + x * CH + c, value[c], den);
+                }
+                weight += taps;
+            }
+            srcp += src_pitch;
+            dstp += dst_pitch;
+        }
+    }
+};
+
+/*
+    the vertical pass works on whole rows, so interleaved formats only
+    differ in the row length. when the accumulator is also the type
+    written (FIRST, float) it accumulates straight into the destination
+    row, otherwise into buff.
+*/
+template <int CH, typename S, typename A, typename D, bool FIRST>
+struct Kernel<false, CH, S, A, D, FIRST> {
+    static void Run(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, const params_t* params, void* buff)
+    {
+        typedef typename weight_table<A>::type W;
+        const bool in_place = same_type<A, D>::value != 0;
+        int row_size = (FIRST ? params->src_width : params->target_width) * CH;
+        int target_height = params->target_height;
+        int taps = params->axis_v.taps;
+        const W* weight = weight_table<A>::get(&params->axis_v);
+        divisor<A> den(params);
+
+        for (int y = 0; y < target_height; y++) {
+            const BYTE* p = srcp + params->axis_v.start[y] * src_pitch;
+            A* value = in_place ? reinterpret_cast<A*>(dstp) : static_cast<A*>(buff);
+            SumRows<false, S>(value, p, src_pitch, weight, taps, row_size, (A)1);
+            if (!in_place) {
+                D* d = reinterpret_cast<D*>(dstp);
+                for (int x = 0; x < row_size; x++) {
+                    store_sum(d + x, value[x], den);
+                }
+            }
+            weight += taps;
+            dstp += dst_pitch;
+        }
+    }
+};
+
+/* instantiates S (read) and A for one SUM_* pair of a stage. */
+template <bool HORIZONTAL, int CH, typename S>
+static pass_t SelectAccumulator(int acc, bool first)
+{
+    if (first) {
+        return acc == SUM_16 ? &Kernel<HORIZONTAL, CH, S, uint16_t, uint16_t, true>::Run
+                             : &Kernel<HORIZONTAL, CH, S, uint32_t, uint32_t, true>::Run;
+    }
+    switch (acc) {
+    case SUM_16:
+        return &Kernel<HORIZONTAL, CH, S, uint16_t, BYTE, false>::Run;
+    case SUM_32:
+        return &Kernel<HORIZONTAL, CH, S, uint32_t, BYTE, false>::Run;
+    default:
+        return &Kernel<HORIZONTAL, CH, S, uint64_t, BYTE, false>::Run;
+    }
+}
+
+template <int CH, bool HORIZONTAL>
+static pass_t SelectPass(int stage, int sum, int acc)
+{
+    switch (stage) {
+    case PASS_FIRST:
+        return SelectAccumulator<HORIZONTAL, CH, BYTE>(sum, true);
+    case PASS_SECOND:
+        if (sum == SUM_16) {
+            return SelectAccumulator<HORIZONTAL, CH, uint16_t>(acc, false);
+        }
+        return SelectAccumulator<HORIZONTAL, CH, uint32_t>(acc, false);
+    default:
+        return SelectAccumulator<HORIZONTAL, CH, BYTE>(acc, false);
+    }
+}
+
+template <int CH>
+static pass_t SelectPass(bool horizontal, int stage, int sum, int acc)
+{
+    return horizontal ? SelectPass<CH, true>(stage, sum, acc) : SelectPass<CH, false>(stage, sum, acc);
+}
+
+pass_t GetPass(int channels, bool horizontal, int stage, int sum, int acc)
+{
+    if (stage == PASS_FIRST ? sum == SUM_64 || acc != sum : sum == SUM_64 || acc < sum) {
+        return NULL;
+    }
+    switch (channels) {
+    case 1:
+        return SelectPass<1>(horizontal, stage, sum, acc);
+    case 3:
+        return SelectPass<3>(horizontal, stage, sum, acc);
+    case 4:
+        return SelectPass<4>(horizontal, stage, sum, acc);
+    default:
+        return NULL;
+    }
+}
+
+pass_t GetFloatPass(bool horizontal)
+{
+    return horizontal ? &Kernel<true, 1, float, float, float, true>::Run
+                      : &Kernel<false, 1, float, float, float, false>::Run;
+}
+
+int SumType(double den)
+{
+    double max = 255.0 * den;
+    return max <= 65535.0 ? SUM_16 : max <= 4294967295.0 ? SUM_32 : SUM_64;
+}
+
+bool WideSum(const params_t* params)
+{
+    return SumType((double)params->den_h * params->den_v) == SUM_64;
+}
+
+/*
+    the vertical passes over horizontal sums of type S that finish a row
+    in their own way (premultiplied, tensors, RGB to YUV, semi-planar).
+    each output row is summed into store.sums(y), 'planes' sources of the
+    same geometry side by side row_size apart, and handed to store(y, sums).
+*/
+template <typename S, typename A, typename STORE>
+static void ResizeVerticalSums(const BYTE* const* srcp, int planes, int src_pitch, const params_t* params,
+                               int row_size, STORE& store)
+{
+    int taps = params->axis_v.taps;
+    const int* weight = params->axis_v.weight;
+
+    for (int y = 0; y < params->target_height; y++) {
+        A* value = store.sums(y);
+        for (int p = 0; p < planes; p++) {
+            SumRows<false, S>(value + p * row_size, srcp[p] + params->axis_v.start[y] * src_pitch,
+                              src_pitch, weight, taps, row_size, (A)1);
+        }
+        store(y, value);
+        weight += taps;
+    }
+}
+
+/*
+    premultiplied BGRA: alpha is truncated like a plain plane, color is the
+    sum of c * a divided by the sum of a, rounded, which is the alpha
+    weighted average at full precision whatever alpha is. the sums of a
+    row are planar: blue, green, red and alpha rows of width each.
+*/
+template <typename A>
+struct premultiplied_store {
+    BYTE* dstp;
+    int dst_pitch;
+    int width;
+    A den;
+
+    premultiplied_store(BYTE* d, int pitch, const params_t* params)
+        : dstp(d), dst_pitch(pitch), width(params->target_width), den((A)params->den_h * params->den_v) {}
+    void operator()(int y, const A* v)
+    {
+        rgb32_t* d = reinterpret_cast<rgb32_t*>(dstp + y * dst_pitch);
+        for (int x = 0; x < width; x++) {
+            A alpha = v[x + 3 * width];
+            A color[3] = {0, 0, 0};
+            if (alpha) {
+                for (int c = 0; c < 3; c++) {
+                    color[c] = (v[x + c * width] + alpha / 2) / alpha;
+                }
+            }
+            d[x].blue = (BYTE)(color[0] > 255 ? 255 : color[0]);
+            d[x].green = (BYTE)(color[1] > 255 ? 255 : color[1]);
+            d[x].red = (BYTE)(color[2] > 255 ? 255 : color[2]);
+            d[x].alpha = (BYTE)(alpha / den);
+        }
+    }
+};
+
+/*
+    one pass, a source row at a time. each source row an output row reads
+    is multiplied by alpha once per pixel (c * a, not rounded) into four
+    planar rows of uint16_t, which the plain planar kernel sums like four
+    rows of a FIRST pass into rows of S. those are added into the output
+    row's A sums and dropped; an output row shares at most its first
+    source row with the one above, which is kept. so there is no
+    intermediate frame, only rows in buff, and both axes read absolute
+    source positions (start[]) even when they keep their size. only the
+    columns the outputs read are premultiplied.
+*/
+template <typename S, typename A>
+static void ResizePremultiplied(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, const params_t* params, void* buff)
+{
+    int src_width = params->src_width;
+    int width = params->target_width;
+    int row_size = width * 4;
+    int taps = params->axis_v.taps;
+    int first = params->axis_h.start[0];
+    int last = params->axis_h.start[width - 1] + params->axis_h.taps;
+    uint16_t* premultiplied = static_cast<uint16_t*>(buff);
+    S* sums = reinterpret_cast<S*>(premultiplied + (size_t)src_width * 4);
+    A* value = reinterpret_cast<A*>(sums + row_size);
+    params_t rows = *params;
+    rows.src_height = 4;
+    premultiplied_store<A> store(dstp, dst_pitch, params);
+    const int* weight = params->axis_v.weight;
+    int summed = -1;
+
+    for (int y = 0; y < params->target_height; y++) {
+        bool added = false;
+        for (int i = 0; i < taps; i++) {
+            if (weight[i] == 0) {
+                continue;
+            }
+            int sy = params->axis_v.start[y] + i;
+            if (sy != summed) {
+                const rgb32_t* p = reinterpret_cast<const rgb32_t*>(srcp + sy * src_pitch);
+                for (int x = first; x < last; x++) {
+                    int a = p[x].alpha;
+                    premultiplied[x] = (uint16_t)(p[x].blue * a);
+                    premultiplied[x + src_width] = (uint16_t)(p[x].green * a);
+                    premultiplied[x + 2 * src_width] = (uint16_t)(p[x].red * a);
+                    premultiplied[x + 3 * src_width] = (uint16_t)a;
+                }
+                Kernel<true, 1, uint16_t, S, S, true>::Run(reinterpret_cast<BYTE*>(sums), width * sizeof(S),
+                                                          reinterpret_cast<const BYTE*>(premultiplied),
+                                                          src_width * sizeof(uint16_t), &rows, NULL);
+                summed = sy;
+            }
+            const BYTE* sp = reinterpret_cast<const BYTE*>(sums);
+            if (added) {
+                SumRows<true, S>(value, sp, 0, weight + i, 1, row_size, (A)1);
+            } else {
+                SumRows<false, S>(value, sp, 0, weight + i, 1, row_size, (A)1);
+                added = true;
+            }
+        }
+        store(y, value);
+        weight += taps;
+    }
+}
+
+/*
+    c * a is at most 255 * 255, and the rounding adds at most half of the
+    alpha sum, so 65535 * den bounds everything a premultiplied sum holds.
+*/
+int PremultipliedSumType(double den)
+{
+    return 65535.0 * den <= 4294967295.0 ? SUM_32 : SUM_64;
+}
+
+pass_t GetPremultipliedPass(int sum, int acc)
+{
+    if (sum == SUM_64) {
+        return &ResizePremultiplied<uint64_t, uint64_t>;
+    }
+    return acc == SUM_64 ? &ResizePremultiplied<uint32_t, uint64_t> : &ResizePremultiplied<uint32_t, uint32_t>;
+}
+
+/* rounded to nearest. */
+static inline BYTE clamp_byte(float value)
+{
+    value += 0.5f;
+    return value <= 0.0f ? 0 : value >= 255.0f ? 255 : (BYTE)value;
+}
+
+static inline void store(float* dstp, float value)
+{
+    *dstp = value;
+}
+
+/* round to nearest even. */
+static inline void store(uint16_t* dstp, float value)
+{
+    uint32_t x;
+    memcpy(&x, &value, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    int exp = (int)((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff) {
+        *dstp = (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0));
+        return;
+    }
+    if (exp >= 31) {
+        *dstp = (uint16_t)(sign | 0x7c00);
+        return;
+    }
+    if (exp <= 0) {
+        if (exp < -10) {
+            *dstp = (uint16_t)sign;
+            return;
+        }
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1))) {
+            h++;
+        }
+        *dstp = (uint16_t)(sign | h);
+        return;
+    }
+    uint32_t h = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) {
+        h++;
+    }
+    *dstp = (uint16_t)h;
+}
+
+/* tensors: planar channels of average * scale + bias. */
+template <typename T, typename A>
+struct tensor_store {
+    T* dstp;
+    long long plane_size;
+    int width;
+    int src_channels;
+    int channels;
+    const int* order;
+    const float* mul;
+    const float* add;
+    A* buff;
+
+    tensor_store(T* d, long long size, const params_t* params, void* b, int src_ch, int ch,
+                 const int* o, const float* m, const float* a)
+        : dstp(d), plane_size(size), width(params->target_width), src_channels(src_ch), channels(ch),
+          order(o), mul(m), add(a), buff(static_cast<A*>(b)) {}
+    A* sums(int y) { return buff; }
+    void operator()(int y, const A* value)
+    {
+        for (int c = 0; c < channels; c++) {
+            T* dst = dstp + c * plane_size + (long long)y * width;
+            const A* v = value + order[c];
+            float m = mul[c];
+            float a = add[c];
+            for (int x = 0; x < width; x++) {
+                store(dst + x, (float)v[x * src_channels] * m + a);
+            }
+        }
+    }
+};
+
+template <typename T, typename A>
+static void ResizeVerticalTensorT(T* dstp, long long plane_size, const BYTE* srcp, int src_pitch,
+                                  const params_t* params, void* buff, int src_channels, int channels,
+                                  const int* order, const float* mul, const float* add)
+{
+    tensor_store<T, A> out(dstp, plane_size, params, buff, src_channels, channels, order, mul, add);
+    ResizeVerticalSums<uint32_t, A>(&srcp, 1, src_pitch, params, params->target_width * src_channels, out);
+}
+
+void ResizeVerticalTensor(void* dstp, int type, long long plane_size, const BYTE* srcp, int src_pitch,
+                          const params_t* params, void* buff, int src_channels, int channels,
+                          const int* order, const float* mul, const float* add)
+{
+    bool wide = WideSum(params);
+    if (type == AR_TENSOR_FLOAT16) {
+        if (wide) {
+            ResizeVerticalTensorT<uint16_t, uint64_t>((uint16_t*)dstp, plane_size, srcp, src_pitch, params,
+                                                      buff, src_channels, channels, order, mul, add);
+        } else {
+            ResizeVerticalTensorT<uint16_t, uint32_t>((uint16_t*)dstp, plane_size, srcp, src_pitch, params,
+                                                      buff, src_channels, channels, order, mul, add);
+        }
+    } else {
+        if (wide) {
+            ResizeVerticalTensorT<float, uint64_t>((float*)dstp, plane_size, srcp, src_pitch, params,
+                                                   buff, src_channels, channels, order, mul, add);
+        } else {
+            ResizeVerticalTensorT<float, uint32_t>((float*)dstp, plane_size, srcp, src_pitch, params,
+                                                   buff, src_channels, channels, order, mul, add);
+        }
+    }
+}
+
+/*
+    temporal accumulation: the vertical pass of one source frame, scaled by
+    its temporal weight and added to a frame of sums that outlives it.
+*/
+void ResizeVerticalAccumulate(uint64_t* acc, const BYTE* srcp, int src_pitch, const params_t* params,
+                              int channels, int weight, bool first)
+{
+    int row_size = params->target_width * channels;
+    int taps = params->axis_v.taps;
+    const int* wv = params->axis_v.weight;
+
+    for (int y = 0; y < params->target_height; y++) {
+        uint64_t* a = acc + (size_t)y * row_size;
+        const BYTE* p = srcp + params->axis_v.start[y] * src_pitch;
+        if (first) {
+            SumRows<false, uint32_t>(a, p, src_pitch, wv, taps, row_size, (uint64_t)weight);
+        } else {
+            SumRows<true, uint32_t>(a, p, src_pitch, wv, taps, row_size, (uint64_t)weight);
+        }
+        wv += taps;
+    }
+}
+
+/*
+    RGB to YUV. every output row of sums is kept until the sub_v rows of a
+    chroma row are done; a chroma sample covers exactly sub_h x sub_v luma
+    samples, so its average is the mean of theirs and comes from the same
+    sums.
+*/
+template <typename A>
+struct yuv_store {
+    BYTE* const* dstp;
+    const int* dst_pitch;
+    int width;
+    int row_size;
+    int src_channels;
+    int sub_h;
+    int sub_v;
+    const float* coef;
+    float inv_den;
+    float inv_block;
+    A* buff;
+
+    yuv_store(BYTE* const* d, const int* pitch, const params_t* params, void* b, int src_ch,
+              int h, int v, const float* c)
+        : dstp(d), dst_pitch(pitch), width(params->target_width), row_size(params->target_width * src_ch),
+          src_channels(src_ch), sub_h(h), sub_v(v), coef(c),
+          inv_den(1.0f / ((float)params->den_h * params->den_v)), inv_block(inv_den / (h * v)),
+          buff(static_cast<A*>(b)) {}
+    A* sums(int y) { return buff + (size_t)(y % sub_v) * row_size; }
+    void operator()(int y, const A* value)
+    {
+        BYTE* luma = dstp[0] + y * dst_pitch[0];
+        for (int x = 0; x < width; x++) {
+            const A* v = value + x * src_channels;
+            float b = (float)v[0] * inv_den, g = (float)v[1] * inv_den, r = (float)v[2] * inv_den;
+            luma[x] = clamp_byte(coef[0] * r + coef[1] * g + coef[2] * b + coef[3]);
+        }
+        if (y % sub_v != sub_v - 1) {
+            return;
+        }
+
+        BYTE* u = dstp[1] + (y / sub_v) * dst_pitch[1];
+        BYTE* v = dstp[2] + (y / sub_v) * dst_pitch[2];
+        for (int x = 0; x < width / sub_h; x++) {
+            A sum[3] = {0, 0, 0};
+            for (int j = 0; j < sub_v; j++) {
+                const A* row = buff + (size_t)j * row_size + x * sub_h * src_channels;
+                for (int i = 0; i < sub_h; i++) {
+                    sum[0] += row[i * src_channels];
+                    sum[1] += row[i * src_channels + 1];
+                    sum[2] += row[i * src_channels + 2];
+                }
+            }
+            float b = (float)sum[0] * inv_block, g = (float)sum[1] * inv_block, r = (float)sum[2] * inv_block;
+            u[x] = clamp_byte(coef[4] * r + coef[5] * g + coef[6] * b + coef[7]);
+            v[x] = clamp_byte(coef[8] * r + coef[9] * g + coef[10] * b + coef[11]);
+        }
+    }
+};
+
+template <typename A>
+static void ResizeVerticalToYUVT(BYTE* const* dstp, const int* dst_pitch, const BYTE* srcp, int src_pitch,
+                                 const params_t* params, void* buff, int src_channels,
+                                 int sub_h, int sub_v, const float* coef)
+{
+    yuv_store<A> store(dstp, dst_pitch, params, buff, src_channels, sub_h, sub_v, coef);
+    ResizeVerticalSums<uint32_t, A>(&srcp, 1, src_pitch, params, params->target_width * src_channels, store);
+}
+
+void ResizeVerticalToYUV(BYTE* const* dstp, const int* dst_pitch, const BYTE* srcp, int src_pitch,
+                         const params_t* params, void* buff, int src_channels,
+                         int sub_h, int sub_v, const float* coef)
+{
+    /* the chroma block sums sub_h * sub_v luma sums. */
+    if (255.0 * params->den_h * params->den_v * sub_h * sub_v > 4294967295.0) {
+        ResizeVerticalToYUVT<uint64_t>(dstp, dst_pitch, srcp, src_pitch, params, buff, src_channels,
+                                       sub_h, sub_v, coef);
+    } else {
+        ResizeVerticalToYUVT<uint32_t>(dstp, dst_pitch, srcp, src_pitch, params, buff, src_channels,
+                                       sub_h, sub_v, coef);
+    }
+}
+
+/*
+    vertical pass into a semi-planar plane: the sums of 'planes' source
+    planes are finished together and written interleaved, 8bit as the
+    usual truncated average, 16bit rounded to 'depth' bits in the high
+    bits of the word.
+*/
+template <typename A, typename D>
+struct semi_planar_store {
+    BYTE* dstp;
+    int dst_pitch;
+    int width;
+    int planes;
+    divisor<A> div;
+    double mul;
+    int shift;
+    A* buff;
+
+    semi_planar_store(BYTE* d, int pitch, int n, const params_t* params, void* b, int depth)
+        : dstp(d), dst_pitch(pitch), width(params->target_width), planes(n), div(params),
+          mul(((1 << depth) - 1) / (255.0 * params->den_h * params->den_v)), shift(16 - depth),
+          buff(static_cast<A*>(b)) {}
+    A* sums(int y) { return buff; }
+    void operator()(int y, const A* value)
+    {
+        D* dst = reinterpret_cast<D*>(dstp + y * dst_pitch);
+        for (int x = 0; x < width; x++) {
+            for (int p = 0; p < planes; p++) {
+                A sum = value[p * width + x];
+                if (sizeof(D) == 1) {
+                    dst[x * planes + p] = (D)div.divide(sum);
+                } else {
+                    dst[x * planes + p] = (D)((int)(sum * mul + 0.5) << shift);
+                }
+            }
+        }
+    }
+};
+
+template <typename A, typename D>
+static void ResizeVerticalSemiPlanarT(BYTE* dstp, int dst_pitch, const BYTE* const* srcp, int src_pitch,
+                                      int planes, const params_t* params, void* buff, int depth)
+{
+    semi_planar_store<A, D> store(dstp, dst_pitch, planes, params, buff, depth);
+    ResizeVerticalSums<uint32_t, A>(srcp, planes, src_pitch, params, params->target_width, store);
+}
+
+void ResizeVerticalSemiPlanar(BYTE* dstp, int dst_pitch, const BYTE* const* srcp, int src_pitch,
+                              int planes, const params_t* params, void* buff, int depth)
+{
+    bool wide = 255.0 * params->den_h * params->den_v > 4294967295.0;
+    if (depth == 8) {
+        if (wide) {
+            ResizeVerticalSemiPlanarT<uint64_t, BYTE>(dstp, dst_pitch, srcp, src_pitch, planes, params, buff, depth);
+        } else {
+            ResizeVerticalSemiPlanarT<uint32_t, BYTE>(dstp, dst_pitch, srcp, src_pitch, planes, params, buff, depth);
+        }
+    } else {
+        if (wide) {
+            ResizeVerticalSemiPlanarT<uint64_t, uint16_t>(dstp, dst_pitch, srcp, src_pitch, planes, params, buff, depth);
+        } else {
+            ResizeVerticalSemiPlanarT<uint32_t, uint16_t>(dstp, dst_pitch, srcp, src_pitch, planes, params, buff, depth);
+        }
+    }
+}
+
+int gcd(int x, int y)
+{
+    int m = x % y;
+    return m == 0 ? y : gcd(y, m);
+}
+
+/*
+    output sample i covers the sub-samples [i * den, (i + 1) * den) and
+    source sample j covers [j * num, (j + 1) * num). the weight is the
+    length of the overlap.
+*/
+static bool InitAxis(axis_t* axis, int src, int target, int num, int den)
+{
+    int taps = 0;
+    for (int i = 0; i < target; i++) {
+        int first = (int)((long long)i * den / num);
+        int last = (int)(((long long)(i + 1) * den - 1) / num);
+        if (last - first + 1 > taps) {
+            taps = last - first + 1;
+        }
+    }
+
+    axis->taps = taps;
+    axis->start = (int*)malloc(sizeof(int) * target);
+    axis->weight = (int*)calloc((size_t)target * taps, sizeof(int));
+    axis->fweight = (float*)malloc(sizeof(float) * (size_t)target * taps);
+    if (!axis->start || !axis->weight || !axis->fweight) {
+        return false;
+    }
+
+    for (int i = 0; i < target; i++) {
+        long long lo = (long long)i * den;
+        long long hi = lo + den;
+        int first = (int)(lo / num);
+        int last = (int)((hi - 1) / num);
+        int start = first + taps > src ? src - taps : first;
+        int* weight = axis->weight + (size_t)i * taps;
+        for (int j = first; j <= last; j++) {
+            long long begin = (long long)j * num;
+            long long end = begin + num;
+            weight[j - start] = (int)((end < hi ? end : hi) - (begin > lo ? begin : lo));
+        }
+        axis->start[i] = start;
+    }
+
+    for (size_t i = 0; i < (size_t)target * taps; i++) {
+        axis->fweight[i] = (float)axis->weight[i] / den;
+    }
+    return true;
+}
+
+bool InitParams(params_t* params, int num_plane, int src_width, int src_height,
+                int target_width, int target_height, int subsample_h, int subsample_v,
+                int target_subsample_h, int target_subsample_v)
+{
+    for (int i = 0; i < num_plane; i++) {
+        params[i].src_width     = i ? src_width / subsample_h : src_width;
+        params[i].src_height    = i ? src_height / subsample_v : src_height;
+        params[i].target_width  = i ? target_width / target_subsample_h : target_width;
+        params[i].target_height = i ? target_height / target_subsample_v : target_height;
+        params[i].axis_h.start = params[i].axis_h.weight = NULL;
+        params[i].axis_v.start = params[i].axis_v.weight = NULL;
+        params[i].axis_h.fweight = params[i].axis_v.fweight = NULL;
+    }
+
+    for (int i = 0; i < num_plane; i++) {
+        int gcd_h = gcd(params[i].src_width, params[i].target_width);
+        int gcd_v = gcd(params[i].src_height, params[i].target_height);
+        params[i].num_h = params[i].target_width / gcd_h;
+        params[i].den_h = params[i].src_width / gcd_h;
+        params[i].num_v = params[i].target_height / gcd_v;
+        params[i].den_v = params[i].src_height / gcd_v;
+        if (!InitAxis(&params[i].axis_h, params[i].src_width, params[i].target_width,
+                      params[i].num_h, params[i].den_h) ||
+            !InitAxis(&params[i].axis_v, params[i].src_height, params[i].target_height,
+                      params[i].num_v, params[i].den_v)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FreeParams(params_t* params, int num_plane)
+{
+    for (int i = 0; i < num_plane; i++) {
+        free(params[i].axis_h.start);
+        free(params[i].axis_h.weight);
+        free(params[i].axis_v.start);
+        free(params[i].axis_v.weight);
+        free(params[i].axis_h.fweight);
+        free(params[i].axis_v.fweight);
+        params[i].axis_h.start = params[i].axis_h.weight = NULL;
+        params[i].axis_v.start = params[i].axis_v.weight = NULL;
+        params[i].axis_h.fweight = params[i].axis_v.fweight = NULL;
+    }
+}
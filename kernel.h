@@ -0,0 +1,178 @@
+/*
+    AreaResize.dll
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    resize kernels and plane geometry used by the library in arearesize.cpp.
+    nothing in here depends on a host API.
+*/
+
+#ifndef AREARESIZE_KERNEL_H
+#define AREARESIZE_KERNEL_H
+
+#include <stdint.h>
+
+typedef unsigned char BYTE;
+
+/*
+    one output sample is the sum of den sub-samples and every source sample
+    provides num of them. axis_t keeps, for each output sample, the first
+    source sample it touches and how many sub-samples each of the following
+    'taps' source samples contribute. outputs near the edge are shifted left
+    and padded with zero weights, so every output reads exactly 'taps'
+    samples and never leaves the source.
+*/
+typedef struct {
+    int taps;
+    int* start;
+    int* weight;
+    float* fweight;  /* weight / den, for the float kernels */
+} axis_t;
+
+typedef struct {
+    int src_width;
+    int src_height;
+    int target_width;
+    int target_height;
+    int num_h;
+    int den_h;
+    int num_v;
+    int den_v;
+    axis_t axis_h;
+    axis_t axis_v;
+} params_t;
+
+/*
+    one resize pass. buff is the per-thread accumulator row (value_size of
+    the plan); the 32bit float kernels do not use it.
+*/
+typedef void (*pass_t)(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, const params_t* params, void* buff);
+
+int gcd(int x, int y);
+
+/*
+    fill params[0..num_plane-1] and build their weight tables.
+    plane 0 is full size, the rest have the source divided by
+    subsample_h/subsample_v and the target by target_subsample_h/v, so
+    chroma can go straight from one subsampling to another.
+    returns false when out of memory. FreeParams() must be called either way.
+*/
+bool InitParams(params_t* params, int num_plane, int src_width, int src_height,
+                int target_width, int target_height, int subsample_h, int subsample_v,
+                int target_subsample_h, int target_subsample_v);
+void FreeParams(params_t* params, int num_plane);
+
+/*
+    8bit kernels for 1, 3 or 4 interleaved channels. a plane that is resized
+    along both axes runs PASS_FIRST along one axis, which keeps the weighted
+    sums, then PASS_SECOND along the other, which divides by den_h * den_v.
+    either order gives the same output. a plane that keeps one of its sizes
+    runs a single PASS_ONLY, BYTE to BYTE. the first pass writes rows of
+    src_height (horizontal) or target_height (vertical) and accumulates in
+    place; the others need an accumulator row of target_width * channels
+    elements of the accumulator type.
+
+    sum is the type of the intermediate (written by PASS_FIRST, read by
+    PASS_SECOND) and acc the accumulator, both SUM_*. they are exact when
+    SumType() of the den summed so far allows them: den of the first axis
+    for sum, den_h * den_v for acc. PASS_FIRST needs acc == sum. returns
+    NULL for a combination that has no kernel.
+*/
+enum {
+    PASS_FIRST,
+    PASS_SECOND,
+    PASS_ONLY
+};
+
+enum {
+    SUM_16,  /* uint16_t */
+    SUM_32,  /* uint32_t */
+    SUM_64   /* uint64_t, accumulator only */
+};
+
+pass_t GetPass(int channels, bool horizontal, int stage, int sum, int acc);
+
+/* the narrowest SUM_* that holds 255 * den. */
+int SumType(double den);
+
+/* true when 255 * den_h * den_v does not fit into 32 bits. */
+bool WideSum(const params_t* params);
+
+/*
+    premultiplied alpha: a single pass that weights color by alpha and
+    divides it back out, reading the source at absolute positions on both
+    axes, which must both run even when one keeps its size. sum (the
+    horizontal sums) and acc as in GetPass(), from PremultipliedSumType()
+    of den_h and den_h * den_v. buff holds src_width * 4 uint16_t and two
+    rows of target_width * 4 sums.
+*/
+int PremultipliedSumType(double den);
+pass_t GetPremultipliedPass(int sum, int acc);
+
+/*
+    32bit float planes, pitches still in bytes, horizontal pass first. the
+    vertical pass accumulates in place, so it needs no buff.
+*/
+pass_t GetFloatPass(bool horizontal);
+
+/*
+    vertical second pass that ends in float instead of BYTE. the rows in
+    srcp hold the uint32_t sums of a horizontal PASS_FIRST with
+    src_channels interleaved channels; output channel c is taken from
+    source channel order[c] and written as its own plane at
+    dstp + c * plane_size (in elements), as sum * mul[c] + add[c].
+    type is AR_TENSOR_FLOAT32 or AR_TENSOR_FLOAT16.
+*/
+void ResizeVerticalTensor(void* dstp, int type, long long plane_size, const BYTE* srcp, int src_pitch,
+                          const params_t* params, void* buff, int src_channels, int channels,
+                          const int* order, const float* mul, const float* add);
+
+/*
+    vertical second pass that adds weight * (the sums of the output) to acc
+    (target_width * channels uint64_t per row, packed) instead of dividing,
+    or stores it there when first is set. srcp holds the uint32_t sums of
+    a horizontal PASS_FIRST over 'channels' interleaved channels.
+*/
+void ResizeVerticalAccumulate(uint64_t* acc, const BYTE* srcp, int src_pitch, const params_t* params,
+                              int channels, int weight, bool first);
+
+/*
+    vertical second pass for RGB to YUV, reading the uint32_t sums of a
+    horizontal PASS_FIRST over src_channels (3 or 4, BGR order). writes
+    luma to dstp[0] and chroma averaged over sub_h x sub_v luma samples to
+    dstp[1] (U) and dstp[2] (V). coef holds the rows Y, U, V of
+    {r, g, b, offset} on 0..255 values. buff needs sub_v rows of
+    target_width * src_channels uint64_t.
+*/
+void ResizeVerticalToYUV(BYTE* const* dstp, const int* dst_pitch, const BYTE* srcp, int src_pitch,
+                         const params_t* params, void* buff, int src_channels,
+                         int sub_h, int sub_v, const float* coef);
+
+/*
+    vertical second pass for NV12/P010/P016 style planes. srcp[0..planes-1]
+    hold the uint32_t sums of a horizontal PASS_FIRST of 1 channel each;
+    their results are written interleaved (UVUV.. for planes = 2) as 8bit
+    for depth 8, or as 16bit words with the rounded depth bit value in the
+    high bits for depth 10 and 16. buff needs planes * target_width
+    uint64_t.
+*/
+void ResizeVerticalSemiPlanar(BYTE* dstp, int dst_pitch, const BYTE* const* srcp, int src_pitch,
+                              int planes, const params_t* params, void* buff, int depth);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+    AreaResize.dll
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mapped_file.h"
+
+struct mapped_file {
+    uint8_t* data;
+    int64_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+#ifdef _WIN32
+
+mapped_file_t* OpenMappedFile(const char* path, int64_t size, bool writable)
+{
+    mapped_file_t* mf = (mapped_file_t*)calloc(1, sizeof(mapped_file_t));
+    if (!mf) {
+        return NULL;
+    }
+    mf->file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mf->file == INVALID_HANDLE_VALUE) {
+        free(mf);
+        return NULL;
+    }
+
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(mf->file, &current)) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+    mf->size = current.QuadPart;
+    if (writable && mf->size < size) {
+        mf->size = size;
+    }
+    if (mf->size == 0 || (int64_t)(size_t)mf->size != mf->size) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+
+    /* mapping a writable file larger than it is extends it with zeros. */
+    mf->mapping = CreateFileMappingA(mf->file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     (DWORD)(mf->size >> 32), (DWORD)mf->size, NULL);
+    if (mf->mapping) {
+        mf->data = (uint8_t*)MapViewOfFile(mf->mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                           0, 0, (size_t)mf->size);
+    }
+    if (!mf->data) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+    return mf;
+}
+
+void CloseMappedFile(mapped_file_t* mf)
+{
+    if (!mf) {
+        return;
+    }
+    if (mf->data) {
+        UnmapViewOfFile(mf->data);
+    }
+    if (mf->mapping) {
+        CloseHandle(mf->mapping);
+    }
+    if (mf->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(mf->file);
+    }
+    free(mf);
+}
+
+/* unlocking pages that are not locked removes them from the working set. */
+void ReleaseMappedRange(const mapped_file_t* mf, int64_t offset, int64_t size)
+{
+    VirtualUnlock(mf->data + offset, (size_t)size);
+}
+
+#else
+
+mapped_file_t* OpenMappedFile(const char* path, int64_t size, bool writable)
+{
+    mapped_file_t* mf = (mapped_file_t*)calloc(1, sizeof(mapped_file_t));
+    if (!mf) {
+        return NULL;
+    }
+    mf->fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (mf->fd < 0) {
+        free(mf);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(mf->fd, &st) != 0) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+    mf->size = st.st_size;
+    if (writable && mf->size < size) {
+        if (ftruncate(mf->fd, size) != 0) {
+            CloseMappedFile(mf);
+            return NULL;
+        }
+        mf->size = size;
+    }
+    if (mf->size == 0 || (int64_t)(size_t)mf->size != mf->size) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+
+    void* p = mmap(NULL, (size_t)mf->size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, mf->fd, 0);
+    if (p == MAP_FAILED) {
+        CloseMappedFile(mf);
+        return NULL;
+    }
+    mf->data = (uint8_t*)p;
+    return mf;
+}
+
+void CloseMappedFile(mapped_file_t* mf)
+{
+    if (!mf) {
+        return;
+    }
+    if (mf->data) {
+        munmap(mf->data, (size_t)mf->size);
+    }
+    close(mf->fd);
+    free(mf);
+}
+
+void ReleaseMappedRange(const mapped_file_t* mf, int64_t offset, int64_t size)
+{
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t begin = (offset + page - 1) / page * page;
+    int64_t end = (offset + size) / page * page;
+    if (end > begin) {
+        madvise(mf->data + begin, (size_t)(end - begin), MADV_DONTNEED);
+    }
+}
+
+#endif
+
+uint8_t* MappedData(const mapped_file_t* mf)
+{
+    return mf->data;
+}
+
+int64_t MappedSize(const mapped_file_t* mf)
+{
+    return mf->size;
+}
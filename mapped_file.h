@@ -0,0 +1,52 @@
+/*
+    AreaResize.dll
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    whole-file memory mapping on windows and posix, shared with other
+    processes that map the same file.
+*/
+
+#ifndef AREARESIZE_MAPPED_FILE_H
+#define AREARESIZE_MAPPED_FILE_H
+
+#include <stdint.h>
+
+typedef struct mapped_file mapped_file_t;
+
+/*
+    maps the whole file. a writable mapping creates the file if needed and
+    grows it with zeros to at least 'size' bytes; a read-only one ignores
+    size. returns NULL on failure.
+*/
+mapped_file_t* OpenMappedFile(const char* path, int64_t size, bool writable);
+void CloseMappedFile(mapped_file_t* file);
+
+/* the view is valid until the file is closed. */
+uint8_t* MappedData(const mapped_file_t* file);
+int64_t MappedSize(const mapped_file_t* file);
+
+/*
+    tells the system that bytes offset..offset+size of a read-only mapping
+    will not be read again soon, so their pages can leave the working set.
+    the data stays valid and is paged in again if it is read.
+*/
+void ReleaseMappedRange(const mapped_file_t* file, int64_t offset, int64_t size);
+
+#endif
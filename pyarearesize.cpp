@@ -0,0 +1,538 @@
+/*
+    arearesize - python binding
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    arearesize.resize(src, width, height, out=None, threads=0, premultiplied=False)
+
+    src is any object exporting a uint8 buffer shaped HxW, HxWxC or NxHxWxC
+    (C = 1, 3 or 4). rows and frames may have any stride, but the pixels of
+    one row must be packed. the buffer is read in place, never copied, and
+    the resize runs with the GIL released. out, when given, must be a
+    writable buffer of the target shape; otherwise a numpy array (or a
+    memoryview when numpy is not installed) is allocated. a 4-D src is split
+    across 'threads' threads (0: number of cpus). premultiplied averages the
+    first three channels weighted by the fourth (alpha).
+
+    arearesize.resize_tensor(src, width, height, scale=1/255, bias=0,
+                             order=None, half=False, out=None, threads=0)
+
+    same input, but the result is a float32/float16 CHW (or NCHW) tensor,
+    normalized per channel inside the resize. out, when given, must be a
+    C-contiguous float32 buffer (float16 with half=True) of that size.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "arearesize.h"
+
+typedef struct {
+    int frames;       /* 0 for a single image */
+    int height;
+    int width;
+    int channels;
+    Py_ssize_t frame_stride;
+    Py_ssize_t row_stride;
+} image_t;
+
+static bool is_uint8(const Py_buffer* view)
+{
+    if (view->itemsize != 1) {
+        return false;
+    }
+    const char* f = view->format;
+    if (!f) {
+        return true;
+    }
+    if (*f == '@' || *f == '=' || *f == '<' || *f == '>' || *f == '!') {
+        f++;
+    }
+    return !strcmp(f, "B");
+}
+
+/* float32 ('f') or float16 ('e') in native byte order. */
+static bool is_float(const Py_buffer* view, bool half)
+{
+    const char* f = view->format;
+    if (view->itemsize != (half ? 2 : 4) || !f) {
+        return false;
+    }
+    const uint16_t one = 1;
+    char native = *(const char*)&one ? '<' : '>';
+    if (*f == '@' || *f == '=' || *f == native) {
+        f++;
+    }
+    return !strcmp(f, half ? "e" : "f");
+}
+
+static bool get_image(const Py_buffer* view, image_t* img, const char* name)
+{
+    if (!is_uint8(view)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a uint8 buffer", name);
+        return false;
+    }
+    int ndim = view->ndim;
+    if (ndim < 2 || ndim > 4) {
+        PyErr_Format(PyExc_ValueError, "%s must be HxW, HxWxC or NxHxWxC", name);
+        return false;
+    }
+
+    const Py_ssize_t* shape = view->shape;
+    const Py_ssize_t* strides = view->strides;
+    int batch = ndim == 4;
+    img->frames = batch ? (int)shape[0] : 0;
+    img->frame_stride = batch ? strides[0] : 0;
+    img->height = (int)shape[batch];
+    img->row_stride = strides[batch];
+    img->width = (int)shape[batch + 1];
+    img->channels = ndim >= 3 ? (int)shape[batch + 2] : 1;
+
+    if (img->channels != 1 && img->channels != 3 && img->channels != 4) {
+        PyErr_Format(PyExc_ValueError, "%s must have 1, 3 or 4 channels", name);
+        return false;
+    }
+    if (strides[batch + 1] != img->channels || (ndim >= 3 && img->channels > 1 && strides[batch + 2] != 1)) {
+        PyErr_Format(PyExc_ValueError, "the pixels of each row of %s must be packed", name);
+        return false;
+    }
+    if (img->row_stride > INT_MAX || img->row_stride < INT_MIN) {
+        PyErr_Format(PyExc_ValueError, "row stride of %s is too large", name);
+        return false;
+    }
+    return true;
+}
+
+static PyObject* new_array(const image_t* img)
+{
+    PyObject* shape = img->frames ?
+        Py_BuildValue("(iiii)", img->frames, img->height, img->width, img->channels) :
+        img->channels > 1 ?
+        Py_BuildValue("(iii)", img->height, img->width, img->channels) :
+        Py_BuildValue("(ii)", img->height, img->width);
+    if (!shape) {
+        return NULL;
+    }
+
+    PyObject* numpy = PyImport_ImportModule("numpy");
+    if (numpy) {
+        PyObject* array = PyObject_CallMethod(numpy, "empty", "(Os)", shape, "uint8");
+        Py_DECREF(numpy);
+        Py_DECREF(shape);
+        return array;
+    }
+    PyErr_Clear();
+
+    Py_ssize_t size = (Py_ssize_t)(img->frames ? img->frames : 1) * img->height * img->width * img->channels;
+    PyObject* bytes = PyByteArray_FromStringAndSize(NULL, size);
+    PyObject* view = bytes ? PyMemoryView_FromObject(bytes) : NULL;
+    Py_XDECREF(bytes);
+    PyObject* array = view ? PyObject_CallMethod(view, "cast", "(sO)", "B", shape) : NULL;
+    Py_XDECREF(view);
+    Py_DECREF(shape);
+    return array;
+}
+
+typedef struct {
+    const ar_plan_t* plan;
+    const uint8_t* src;
+    uint8_t* dst;
+    Py_ssize_t src_stride;
+    Py_ssize_t dst_stride;
+    int src_pitch;
+    int dst_pitch;
+    const ar_tensor_t* tensor;  /* NULL for 8bit output */
+    int first;
+    int last;
+    int ret;
+} job_t;
+
+static void run_job(job_t* job)
+{
+    ar_scratch_t* scratch = ar_create_scratch(job->plan);
+    if (!scratch) {
+        job->ret = AR_ERROR_NOMEM;
+        return;
+    }
+    job->ret = AR_OK;
+    for (int f = job->first; f < job->last && job->ret == AR_OK; f++) {
+        const uint8_t* srcp = job->src + f * job->src_stride;
+        uint8_t* dstp = job->dst + f * job->dst_stride;
+        job->ret = job->tensor ?
+            ar_resize_tensor(job->plan, scratch, job->tensor, &srcp, &job->src_pitch, dstp) :
+            ar_resize(job->plan, scratch, &srcp, &job->src_pitch, &dstp, &job->dst_pitch);
+    }
+    ar_free_scratch(scratch);
+}
+
+static int resize_frames(job_t* whole, int frames, int threads)
+{
+    if (threads > frames) {
+        threads = frames;
+    }
+    if (threads <= 1) {
+        whole->first = 0;
+        whole->last = frames;
+        run_job(whole);
+        return whole->ret;
+    }
+
+    std::vector<job_t> jobs(threads, *whole);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        jobs[i].first = frames * i / threads;
+        jobs[i].last = frames * (i + 1) / threads;
+        workers.push_back(std::thread(run_job, &jobs[i]));
+    }
+    int ret = AR_OK;
+    for (int i = 0; i < threads; i++) {
+        workers[i].join();
+        if (jobs[i].ret != AR_OK) {
+            ret = jobs[i].ret;
+        }
+    }
+    return ret;
+}
+
+static PyObject* py_resize(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"src", "width", "height", "out", "threads", "premultiplied", NULL};
+    PyObject* src_obj;
+    PyObject* out_obj = Py_None;
+    int target_width, target_height;
+    int threads = 0;
+    int premultiplied = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oii|Oip", (char**)keywords,
+                                     &src_obj, &target_width, &target_height, &out_obj, &threads,
+                                     &premultiplied)) {
+        return NULL;
+    }
+
+    Py_buffer src_view, dst_view;
+    if (PyObject_GetBuffer(src_obj, &src_view, PyBUF_STRIDES | PyBUF_FORMAT) < 0) {
+        return NULL;
+    }
+    image_t src;
+    if (!get_image(&src_view, &src, "src")) {
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+
+    if (premultiplied && src.channels != 4) {
+        PyErr_SetString(PyExc_ValueError, "premultiplied needs 4 channels");
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+
+    image_t dst = src;
+    dst.width = target_width;
+    dst.height = target_height;
+    if (out_obj == Py_None) {
+        out_obj = new_array(&dst);
+    } else {
+        Py_INCREF(out_obj);
+    }
+    if (!out_obj) {
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(out_obj, &dst_view, PyBUF_STRIDES | PyBUF_FORMAT | PyBUF_WRITABLE) < 0) {
+        Py_DECREF(out_obj);
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+
+    image_t out;
+    if (!get_image(&dst_view, &out, "out")) {
+        goto fail;
+    }
+    if (dst_view.ndim != src_view.ndim || out.frames != src.frames || out.channels != src.channels ||
+        out.width != target_width || out.height != target_height) {
+        PyErr_SetString(PyExc_ValueError, "out does not have the target shape");
+        goto fail;
+    }
+
+    {
+        ar_config_t config;
+        ar_plan_t* plan;
+        int format = src.channels == 4 ? AR_FORMAT_RGB32 :
+                     src.channels == 3 ? AR_FORMAT_RGB24 : AR_FORMAT_GRAY;
+        ar_init_config(&config, src.width, src.height, target_width, target_height, format, 1, 1);
+        config.premultiplied = premultiplied;
+        int ret = ar_create_plan(&config, &plan);
+        if (ret != AR_OK) {
+            PyErr_SetString(ret == AR_ERROR_NOMEM ? PyExc_MemoryError : PyExc_ValueError,
+                            ret == AR_ERROR_UNSUPPORTED ? "arearesize only scales down" : ar_strerror(ret));
+            goto fail;
+        }
+
+        if (threads <= 0) {
+            threads = (int)std::thread::hardware_concurrency();
+        }
+        job_t job;
+        job.plan = plan;
+        job.src = (const uint8_t*)src_view.buf;
+        job.dst = (uint8_t*)dst_view.buf;
+        job.src_stride = src.frame_stride;
+        job.dst_stride = out.frame_stride;
+        job.src_pitch = (int)src.row_stride;
+        job.dst_pitch = (int)out.row_stride;
+        job.tensor = NULL;
+
+        Py_BEGIN_ALLOW_THREADS
+        ret = resize_frames(&job, src.frames ? src.frames : 1, threads);
+        Py_END_ALLOW_THREADS
+
+        ar_free_plan(plan);
+        if (ret != AR_OK) {
+            PyErr_SetString(PyExc_MemoryError, ar_strerror(ret));
+            goto fail;
+        }
+    }
+
+    PyBuffer_Release(&dst_view);
+    PyBuffer_Release(&src_view);
+    return out_obj;
+
+fail:
+    PyBuffer_Release(&dst_view);
+    PyBuffer_Release(&src_view);
+    Py_DECREF(out_obj);
+    return NULL;
+}
+
+/* a float or a sequence of up to 4 floats. */
+static bool get_floats(PyObject* obj, float* values, const char* name)
+{
+    if (!obj || obj == Py_None) {
+        return true;
+    }
+    if (PyNumber_Check(obj)) {
+        double v = PyFloat_AsDouble(obj);
+        if (v == -1.0 && PyErr_Occurred()) {
+            return false;
+        }
+        for (int c = 0; c < 4; c++) {
+            values[c] = (float)v;
+        }
+        return true;
+    }
+    PyObject* seq = PySequence_Fast(obj, name);
+    if (!seq) {
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    if (n < 1 || n > 4) {
+        Py_DECREF(seq);
+        PyErr_Format(PyExc_ValueError, "%s must have 1 to 4 items", name);
+        return false;
+    }
+    for (Py_ssize_t c = 0; c < n; c++) {
+        values[c] = (float)PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, c));
+    }
+    Py_DECREF(seq);
+    return !PyErr_Occurred();
+}
+
+static PyObject* new_tensor(int frames, int channels, int height, int width, bool half)
+{
+    PyObject* shape = frames ?
+        Py_BuildValue("(iiii)", frames, channels, height, width) :
+        Py_BuildValue("(iii)", channels, height, width);
+    if (!shape) {
+        return NULL;
+    }
+
+    PyObject* numpy = PyImport_ImportModule("numpy");
+    if (numpy) {
+        PyObject* array = PyObject_CallMethod(numpy, "empty", "(Os)", shape, half ? "float16" : "float32");
+        Py_DECREF(numpy);
+        Py_DECREF(shape);
+        return array;
+    }
+    PyErr_Clear();
+
+    /* memoryview can not be cast to 'e', float16 comes back as raw uint16. */
+    Py_ssize_t size = (Py_ssize_t)(frames ? frames : 1) * channels * height * width * (half ? 2 : 4);
+    PyObject* bytes = PyByteArray_FromStringAndSize(NULL, size);
+    PyObject* view = bytes ? PyMemoryView_FromObject(bytes) : NULL;
+    Py_XDECREF(bytes);
+    PyObject* array = view ? PyObject_CallMethod(view, "cast", "(sO)", half ? "H" : "f", shape) : NULL;
+    Py_XDECREF(view);
+    Py_DECREF(shape);
+    return array;
+}
+
+static PyObject* py_resize_tensor(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"src", "width", "height", "scale", "bias", "order",
+                                     "half", "out", "threads", NULL};
+    PyObject* src_obj;
+    PyObject* scale_obj = NULL;
+    PyObject* bias_obj = NULL;
+    PyObject* order_obj = NULL;
+    PyObject* out_obj = Py_None;
+    int target_width, target_height;
+    int half = 0;
+    int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oii|OOOpOi", (char**)keywords,
+                                     &src_obj, &target_width, &target_height, &scale_obj,
+                                     &bias_obj, &order_obj, &half, &out_obj, &threads)) {
+        return NULL;
+    }
+
+    ar_tensor_t tensor;
+    ar_init_tensor(&tensor, half ? AR_TENSOR_FLOAT16 : AR_TENSOR_FLOAT32);
+    if (!get_floats(scale_obj, tensor.scale, "scale") || !get_floats(bias_obj, tensor.bias, "bias")) {
+        return NULL;
+    }
+    if (order_obj && order_obj != Py_None) {
+        PyObject* seq = PySequence_Fast(order_obj, "order must be a sequence");
+        if (!seq) {
+            return NULL;
+        }
+        Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+        for (Py_ssize_t c = 0; c < n && c < 4; c++) {
+            tensor.order[c] = (int)PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, c));
+        }
+        tensor.channels = (int)n;
+        Py_DECREF(seq);
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+        if (n < 1 || n > 4) {
+            PyErr_SetString(PyExc_ValueError, "order must have 1 to 4 items");
+            return NULL;
+        }
+    }
+
+    Py_buffer src_view, dst_view;
+    if (PyObject_GetBuffer(src_obj, &src_view, PyBUF_STRIDES | PyBUF_FORMAT) < 0) {
+        return NULL;
+    }
+    image_t src;
+    if (!get_image(&src_view, &src, "src")) {
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+    for (int c = 0; c < tensor.channels; c++) {
+        if (tensor.order[c] < 0 || tensor.order[c] >= src.channels) {
+            PyBuffer_Release(&src_view);
+            PyErr_SetString(PyExc_ValueError, "order refers to a channel src does not have");
+            return NULL;
+        }
+    }
+    int channels = tensor.channels ? tensor.channels : src.channels;
+
+    bool given = out_obj != Py_None;
+    if (!given) {
+        out_obj = new_tensor(src.frames, channels, target_height, target_width, half != 0);
+    } else {
+        Py_INCREF(out_obj);
+    }
+    if (!out_obj) {
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(out_obj, &dst_view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE) < 0) {
+        Py_DECREF(out_obj);
+        PyBuffer_Release(&src_view);
+        return NULL;
+    }
+
+    Py_ssize_t frame_size = (Py_ssize_t)channels * target_height * target_width * (half ? 2 : 4);
+    /* without numpy our own float16 tensor is a uint16 view, so only a given out is checked. */
+    if (given && !is_float(&dst_view, half != 0)) {
+        PyErr_SetString(PyExc_TypeError, half ? "out must be a float16 buffer" : "out must be a float32 buffer");
+        goto fail;
+    }
+    if (dst_view.len != frame_size * (src.frames ? src.frames : 1)) {
+        PyErr_SetString(PyExc_ValueError, "out does not have the size of the tensor");
+        goto fail;
+    }
+
+    {
+        ar_config_t config;
+        ar_plan_t* plan;
+        int format = src.channels == 4 ? AR_FORMAT_RGB32 :
+                     src.channels == 3 ? AR_FORMAT_RGB24 : AR_FORMAT_GRAY;
+        ar_init_config(&config, src.width, src.height, target_width, target_height, format, 1, 1);
+        int ret = ar_create_plan(&config, &plan);
+        if (ret != AR_OK) {
+            PyErr_SetString(ret == AR_ERROR_NOMEM ? PyExc_MemoryError : PyExc_ValueError,
+                            ret == AR_ERROR_UNSUPPORTED ? "arearesize only scales down" : ar_strerror(ret));
+            goto fail;
+        }
+
+        if (threads <= 0) {
+            threads = (int)std::thread::hardware_concurrency();
+        }
+        job_t job;
+        job.plan = plan;
+        job.src = (const uint8_t*)src_view.buf;
+        job.dst = (uint8_t*)dst_view.buf;
+        job.src_stride = src.frame_stride;
+        job.dst_stride = frame_size;
+        job.src_pitch = (int)src.row_stride;
+        job.dst_pitch = 0;
+        job.tensor = &tensor;
+
+        Py_BEGIN_ALLOW_THREADS
+        ret = resize_frames(&job, src.frames ? src.frames : 1, threads);
+        Py_END_ALLOW_THREADS
+
+        ar_free_plan(plan);
+        if (ret != AR_OK) {
+            PyErr_SetString(ret == AR_ERROR_NOMEM ? PyExc_MemoryError : PyExc_ValueError, ar_strerror(ret));
+            goto fail;
+        }
+    }
+
+    PyBuffer_Release(&dst_view);
+    PyBuffer_Release(&src_view);
+    return out_obj;
+
+fail:
+    PyBuffer_Release(&dst_view);
+    PyBuffer_Release(&src_view);
+    Py_DECREF(out_obj);
+    return NULL;
+}
+
+static PyMethodDef methods[] = {
+    {"resize", (PyCFunction)py_resize, METH_VARARGS | METH_KEYWORDS,
+     "resize(src, width, height, out=None, threads=0, premultiplied=False)\n\n"
+     "area-average downscale of a uint8 HxW, HxWxC or NxHxWxC buffer."},
+    {"resize_tensor", (PyCFunction)py_resize_tensor, METH_VARARGS | METH_KEYWORDS,
+     "resize_tensor(src, width, height, scale=1/255, bias=0, order=None, half=False, out=None, threads=0)\n\n"
+     "downscale straight into a float32 (float16 with half=True) CHW or NCHW tensor,\n"
+     "out = average * scale[c] + bias[c]. order selects and reorders the channels."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "arearesize", "area-average downscaler", -1, methods
+};
+
+PyMODINIT_FUNC PyInit_arearesize(void)
+{
+    return PyModule_Create(&module);
+}
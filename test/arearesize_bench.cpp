@@ -0,0 +1,231 @@
+/*
+    throughput of the common workloads, against a stored baseline.
+
+    each workload runs for at least MIN_SECONDS, RUNS times, and the
+    best run counts, as source megapixels per second. the baseline is a
+    text file of "name<TAB>mpix/s" lines written by --save on the same
+    machine; a workload that falls more than threshold percent below it
+    fails the run.
+
+    usage: arearesize_bench [--save] baseline [threshold]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../arearesize.h"
+
+#define RUNS 7
+#define MIN_SECONDS 0.15
+
+enum {
+    RUN_RESIZE,
+    RUN_TENSOR,
+    RUN_THREADS
+};
+
+struct workload_t {
+    const char* name;
+    int format;
+    int src_width, src_height, dst_width, dst_height;
+    int sub;         /* subsample_h/v of AR_FORMAT_YUV */
+    int sample_type;
+    int premultiplied;
+    int output_format;
+    int run;
+};
+
+static const workload_t workloads[] = {
+    {"yv12_1080p_720p",        AR_FORMAT_YUV,   1920, 1080, 1280, 720, 2, AR_SAMPLE_U8,    0, AR_FORMAT_YUV,  RUN_RESIZE},
+    {"yv12_1080p_480p",        AR_FORMAT_YUV,   1920, 1080,  854, 480, 2, AR_SAMPLE_U8,    0, AR_FORMAT_YUV,  RUN_RESIZE},
+    {"yv12_1080p_nv12_720p",   AR_FORMAT_YUV,   1920, 1080, 1280, 720, 2, AR_SAMPLE_U8,    0, AR_FORMAT_NV12, RUN_RESIZE},
+    {"rgb32_1080p_720p",       AR_FORMAT_RGB32, 1920, 1080, 1280, 720, 1, AR_SAMPLE_U8,    0, AR_FORMAT_RGB32, RUN_RESIZE},
+    {"rgb32_1080p_720p_pm",    AR_FORMAT_RGB32, 1920, 1080, 1280, 720, 1, AR_SAMPLE_U8,    1, AR_FORMAT_RGB32, RUN_RESIZE},
+    {"rgb24_1080p_yv12_720p",  AR_FORMAT_RGB24, 1920, 1080, 1280, 720, 2, AR_SAMPLE_U8,    0, AR_FORMAT_YUV,  RUN_RESIZE},
+    {"gray_4k_1080p",          AR_FORMAT_GRAY,  3840, 2160, 1920, 1080, 1, AR_SAMPLE_U8,   0, AR_FORMAT_GRAY, RUN_RESIZE},
+    {"gray_4k_thumb",          AR_FORMAT_GRAY,  3840, 2160,  160,  90, 1, AR_SAMPLE_U8,    0, AR_FORMAT_GRAY, RUN_RESIZE},
+    {"float_1080p_720p",       AR_FORMAT_GRAY,  1920, 1080, 1280, 720, 1, AR_SAMPLE_FLOAT, 0, AR_FORMAT_GRAY, RUN_RESIZE},
+    {"tensor_rgb24_1080p_224", AR_FORMAT_RGB24, 1920, 1080,  224, 224, 1, AR_SAMPLE_U8,    0, AR_FORMAT_RGB24, RUN_TENSOR},
+    {"yv12_1080p_720p_threads", AR_FORMAT_YUV,  1920, 1080, 1280, 720, 2, AR_SAMPLE_U8,    0, AR_FORMAT_YUV,  RUN_THREADS},
+};
+
+struct frame_t {
+    std::vector<std::vector<uint8_t> > buff;
+    std::vector<uint8_t*> ptr;
+    std::vector<int> pitch;
+
+    void init(int planes, const int* row_size, const int* height)
+    {
+        buff.resize(planes);
+        ptr.resize(planes);
+        pitch.resize(planes);
+        for (int i = 0; i < planes; i++) {
+            pitch[i] = (row_size[i] + 63) & ~63;
+            buff[i].resize((size_t)pitch[i] * height[i]);
+            for (size_t k = 0; k < buff[i].size(); k++) {
+                buff[i][k] = (uint8_t)(k * 2654435761u >> 13);
+            }
+            ptr[i] = &buff[i][0];
+        }
+    }
+};
+
+static double seconds(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* source megapixels per second of one workload, best of RUNS runs. */
+static double measure(const workload_t& w)
+{
+    ar_config_t config;
+    int sub = w.format == AR_FORMAT_YUV ? w.sub : 1;
+    ar_init_config(&config, w.src_width, w.src_height, w.dst_width, w.dst_height, w.format, sub, sub);
+    config.sample_type = w.sample_type;
+    config.premultiplied = w.premultiplied;
+    if (w.output_format != w.format) {
+        config.output_format = w.output_format;
+        config.output_subsample_h = config.output_subsample_v = w.sub;
+    }
+    ar_plan_t* plan;
+    if (ar_create_plan(&config, &plan) != AR_OK) {
+        return 0.0;
+    }
+
+    int bytes = w.format == AR_FORMAT_RGB24 ? 3 : w.format == AR_FORMAT_RGB32 ? 4
+              : w.sample_type == AR_SAMPLE_FLOAT ? 4 : 1;
+    int src_planes = w.format == AR_FORMAT_YUV ? 3 : 1;
+    int row_size[AR_MAX_PLANES], height[AR_MAX_PLANES];
+    for (int i = 0; i < src_planes; i++) {
+        row_size[i] = (i ? w.src_width / sub : w.src_width) * bytes;
+        height[i] = i ? w.src_height / sub : w.src_height;
+    }
+    frame_t src;
+    src.init(src_planes, row_size, height);
+
+    int dst_planes = ar_plane_count(plan);
+    for (int i = 0; i < dst_planes; i++) {
+        int width;
+        ar_plane_size(plan, i, &width, &height[i]);
+        int out_bytes = w.output_format == AR_FORMAT_NV12 && i ? 2 : w.output_format == w.format ? bytes : 1;
+        row_size[i] = width * out_bytes;
+    }
+
+    int threads = w.run == RUN_THREADS ? (int)std::thread::hardware_concurrency() : 1;
+    threads = threads < 1 ? 1 : threads;
+    std::vector<frame_t> dst(threads);
+    for (int t = 0; t < threads; t++) {
+        dst[t].init(dst_planes, row_size, height);
+    }
+    std::vector<float> tensor_out;
+    ar_tensor_t tensor;
+    ar_init_tensor(&tensor, AR_TENSOR_FLOAT32);
+    if (w.run == RUN_TENSOR) {
+        tensor_out.resize((size_t)3 * w.dst_width * w.dst_height);
+    }
+
+    /* allocated once, so the timed frames do not include it. */
+    ar_scratch_t* scratch = ar_create_scratch(plan);
+    const uint8_t* const* srcp = (const uint8_t* const*)&src.ptr[0];
+    double pixels = (double)w.src_width * w.src_height;
+    double best = 0.0;
+    for (int run = 0; run < RUNS; run++) {
+        int frames = 0;
+        double start = seconds(), elapsed;
+        if (w.run == RUN_THREADS) {
+            /* every thread with its own scratch, as AviSynth and the command line tool run. */
+            std::vector<int> done(threads, 0);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.push_back(std::thread([&, t]() {
+                    ar_scratch_t* own = ar_create_scratch(plan);
+                    do {
+                        ar_resize(plan, own, srcp, &src.pitch[0], &dst[t].ptr[0], &dst[t].pitch[0]);
+                        done[t]++;
+                    } while (seconds() - start < MIN_SECONDS);
+                    ar_free_scratch(own);
+                }));
+            }
+            for (int t = 0; t < threads; t++) {
+                workers[t].join();
+                frames += done[t];
+            }
+            elapsed = seconds() - start;
+        } else {
+            do {
+                if (w.run == RUN_TENSOR) {
+                    ar_resize_tensor(plan, scratch, &tensor, srcp, &src.pitch[0], &tensor_out[0]);
+                } else {
+                    ar_resize(plan, scratch, srcp, &src.pitch[0], &dst[0].ptr[0], &dst[0].pitch[0]);
+                }
+                frames++;
+                elapsed = seconds() - start;
+            } while (elapsed < MIN_SECONDS);
+        }
+        double rate = pixels * frames / elapsed / 1e6;
+        best = rate > best ? rate : best;
+    }
+    ar_free_scratch(scratch);
+    ar_free_plan(plan);
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    bool save = argc > 1 && !strcmp(argv[1], "--save");
+    const char* path = argc > 1 + save ? argv[1 + save] : "bench_baseline.txt";
+    double threshold = argc > 2 + save ? atof(argv[2 + save]) : 15.0;
+
+    std::map<std::string, double> baseline;
+    FILE* fp = save ? NULL : fopen(path, "r");
+    if (fp) {
+        char name[128];
+        double rate;
+        while (fscanf(fp, "%127s %lf", name, &rate) == 2) {
+            baseline[name] = rate;
+        }
+        fclose(fp);
+    } else if (!save) {
+        printf("no baseline in %s, run \"make baseline\" first; only reporting\n", path);
+    }
+
+    int slower = 0;
+    std::vector<double> rates;
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        const workload_t& w = workloads[i];
+        double rate = measure(w);
+        rates.push_back(rate);
+        printf("%-26s %10.1f Mpix/s", w.name, rate);
+        std::map<std::string, double>::const_iterator base = baseline.find(w.name);
+        if (base != baseline.end() && base->second > 0.0) {
+            double change = (rate / base->second - 1.0) * 100.0;
+            bool failed = change < -threshold;
+            slower += failed;
+            printf("  %+6.1f%%%s", change, failed ? "  SLOWER" : "");
+        }
+        printf("\n");
+    }
+
+    if (save) {
+        fp = fopen(path, "w");
+        if (!fp) {
+            printf("cannot write %s\n", path);
+            return 1;
+        }
+        for (size_t i = 0; i < rates.size(); i++) {
+            fprintf(fp, "%s\t%.1f\n", workloads[i].name, rates[i]);
+        }
+        fclose(fp);
+        printf("baseline saved to %s\n", path);
+        return 0;
+    }
+    if (slower) {
+        printf("%d workloads more than %.0f%% slower than the baseline\n", slower, threshold);
+    }
+    return slower ? 1 : 0;
+}
@@ -0,0 +1,1074 @@
+/*
+    randomized regression test of the library against a brute-force area
+    average.
+
+    every output sample is recomputed from the definition: the sum of the
+    source samples weighted by their overlap with the output pixel, as
+    integers, divided by the total overlap. the exact 8bit kernels must
+    give floor() of that, the others stay within their documented bound.
+    regions, streams, batches, temporal averaging, tensors, RGB to YUV
+    and semi-planar output are checked the same way, and one plan is
+    shared by several threads at the end.
+
+    usage: arearesize_test [iterations [seed [test name]]]
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "../arearesize.h"
+
+typedef long long int64;
+
+static unsigned long long rng_state = 88172645463325252ULL;
+
+static unsigned rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned)(rng_state >> 16);
+}
+
+static int rnd(int n)
+{
+    return (int)(rnd() % (unsigned)n);
+}
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (failures++ < 20) { \
+                printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                printf(__VA_ARGS__); \
+                printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+/* one plane of an image; a negative pitch stores it bottom-up. */
+struct plane_t {
+    std::vector<uint8_t> buff;
+    uint8_t* data;
+    int pitch;
+    int width;
+    int height;
+    int bpp;   /* bytes per pixel */
+
+    void init(int w, int h, int bytes_per_pixel, bool flip, int padding = -1)
+    {
+        width = w;
+        height = h;
+        bpp = bytes_per_pixel;
+        int row_size = w * bpp;
+        int stride = row_size + (padding < 0 ? rnd(3) * 16 : padding);
+        buff.assign((size_t)stride * h + 16, 0);
+        data = &buff[0];
+        pitch = stride;
+        if (flip) {
+            data += (size_t)stride * (h - 1);
+            pitch = -stride;
+        }
+    }
+    uint8_t* row(int y) const { return data + (int64)y * pitch; }
+    uint8_t& at(int x, int y, int b) const { return row(y)[x * bpp + b]; }
+    float& f(int x, int y) const { return *(float*)(row(y) + x * 4); }
+};
+
+/* overlap of [a0, a1) and [b0, b1). */
+static int64 overlap(int64 a0, int64 a1, int64 b0, int64 b1)
+{
+    int64 l = a0 > b0 ? a0 : b0, r = a1 < b1 ? a1 : b1;
+    return r > l ? r - l : 0;
+}
+
+/*
+    source sample s of an axis of src samples spans [s * dst, (s + 1) * dst)
+    and output sample d spans [d * src, (d + 1) * src), so an output always
+    covers src units in total.
+*/
+struct axis_ref_t {
+    std::vector<int> first, count;
+    std::vector<std::vector<int64> > weight;
+
+    void init(int src, int dst)
+    {
+        first.resize(dst);
+        count.resize(dst);
+        weight.resize(dst);
+        for (int d = 0; d < dst; d++) {
+            int s0 = (int)((int64)d * src / dst);
+            first[d] = s0;
+            weight[d].clear();
+            for (int s = s0; s < src; s++) {
+                int64 w = overlap((int64)s * dst, (int64)(s + 1) * dst, (int64)d * src, (int64)(d + 1) * src);
+                if (!w) {
+                    break;
+                }
+                weight[d].push_back(w);
+            }
+            count[d] = (int)weight[d].size();
+        }
+    }
+};
+
+/* weighted sum of the source over output pixel (x, y), channel b. total is src_w * src_h. */
+static int64 area_sum(const plane_t& src, const axis_ref_t& h, const axis_ref_t& v, int x, int y, int b)
+{
+    int64 sum = 0;
+    for (int j = 0; j < v.count[y]; j++) {
+        int64 row = 0;
+        for (int i = 0; i < h.count[x]; i++) {
+            row += src.at(h.first[x] + i, v.first[y] + j, b) * h.weight[x][i];
+        }
+        sum += row * v.weight[y][j];
+    }
+    return sum;
+}
+
+static double area_average(const plane_t& src, const axis_ref_t& h, const axis_ref_t& v, int x, int y, int b)
+{
+    if (src.bpp == 4 && b < 0) {
+        double sum = 0.0;
+        for (int j = 0; j < v.count[y]; j++) {
+            for (int i = 0; i < h.count[x]; i++) {
+                sum += (double)src.f(h.first[x] + i, v.first[y] + j) * h.weight[x][i] * v.weight[y][j];
+            }
+        }
+        return sum / ((double)src.width * src.height);
+    }
+    return (double)area_sum(src, h, v, x, y, b) / ((double)src.width * src.height);
+}
+
+/* a random source geometry and format, with the planes as the library should see them. */
+struct case_t {
+    ar_config_t config;
+    int num_plane;
+    int channels;  /* interleaved channels of an 8bit plane */
+    int src_w[AR_MAX_PLANES], src_h[AR_MAX_PLANES];
+    int dst_w[AR_MAX_PLANES], dst_h[AR_MAX_PLANES];
+    std::vector<plane_t> src;
+
+    int bpp() const { return config.sample_type == AR_SAMPLE_FLOAT ? 4 : channels; }
+};
+
+static const int subsamples[][2] = {{2, 2}, {2, 1}, {1, 1}, {4, 1}, {4, 4}, {1, 2}};
+
+/*
+    sizes favour the awkward cases: coprime ratios, odd chroma sizes,
+    reductions to a single row or column and axes that keep their size.
+*/
+static void random_size(int sub, int max_units, int* src, int* dst)
+{
+    int units = 1 + rnd(max_units);
+    *src = units * sub;
+    switch (rnd(6)) {
+    case 0:
+        *dst = *src;
+        break;
+    case 1:
+        *dst = sub;
+        break;
+    case 2: {
+        /* a target coprime to the source (in units). */
+        int t = 1 + rnd(units);
+        while (t > 1) {
+            int a = units, b = t;
+            while (b) {
+                int r = a % b;
+                a = b;
+                b = r;
+            }
+            if (a == 1) {
+                break;
+            }
+            t--;
+        }
+        *dst = t * sub;
+        break;
+    }
+    case 3:
+        /* odd unit counts give odd chroma sizes. */
+        *dst = ((1 + rnd(units)) | 1) * sub;
+        if (*dst > *src) {
+            *dst = *src;
+        }
+        break;
+    default:
+        *dst = (1 + rnd(units)) * sub;
+    }
+}
+
+static void make_case(case_t* c, int format, bool want_float, int max_units)
+{
+    int sub_h = 1, sub_v = 1;
+    if (format == AR_FORMAT_YUV) {
+        int s = rnd(6);
+        sub_h = subsamples[s][0];
+        sub_v = subsamples[s][1];
+    }
+    int src_w, src_h, dst_w, dst_h;
+    random_size(sub_h, max_units, &src_w, &dst_w);
+    random_size(sub_v, max_units * 3 / 4 + 1, &src_h, &dst_h);
+    ar_init_config(&c->config, src_w, src_h, dst_w, dst_h, format, sub_h, sub_v);
+    c->config.order = rnd(3);
+    bool planar = format == AR_FORMAT_GRAY || format == AR_FORMAT_YUV || format == AR_FORMAT_RGBP;
+    if (want_float && planar) {
+        c->config.sample_type = AR_SAMPLE_FLOAT;
+    }
+    if (planar && rnd(4) == 0) {
+        c->config.alpha = 1;
+    }
+    if (format == AR_FORMAT_YUV && rnd(3) == 0) {
+        /* chroma straight to a smaller subsampling, when the target allows it. */
+        int s = rnd(6);
+        int out_h = subsamples[s][0], out_v = subsamples[s][1];
+        if (dst_w % out_h == 0 && dst_h % out_v == 0 &&
+            dst_w / out_h <= src_w / sub_h && dst_h / out_v <= src_h / sub_v) {
+            c->config.output_subsample_h = out_h;
+            c->config.output_subsample_v = out_v;
+        }
+    }
+
+    c->channels = format == AR_FORMAT_RGB24 ? 3 : format == AR_FORMAT_RGB32 ? 4 : 1;
+    c->num_plane = (format == AR_FORMAT_YUV || format == AR_FORMAT_RGBP ? 3 : 1) + c->config.alpha;
+    for (int i = 0; i < c->num_plane; i++) {
+        bool chroma = format == AR_FORMAT_YUV && (i == 1 || i == 2);
+        c->src_w[i] = chroma ? src_w / sub_h : src_w;
+        c->src_h[i] = chroma ? src_h / sub_v : src_h;
+        c->dst_w[i] = chroma ? dst_w / c->config.output_subsample_h : dst_w;
+        c->dst_h[i] = chroma ? dst_h / c->config.output_subsample_v : dst_h;
+    }
+}
+
+static void fill_source(case_t* c, int frames)
+{
+    /* frames of a batch share their pitches. */
+    bool flip = rnd(4) == 0;
+    int padding[AR_MAX_PLANES];
+    for (int i = 0; i < c->num_plane; i++) {
+        padding[i] = rnd(3) * 16;
+    }
+    c->src.resize(frames * c->num_plane);
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < c->num_plane; i++) {
+            plane_t& p = c->src[f * c->num_plane + i];
+            p.init(c->src_w[i], c->src_h[i], c->bpp(), flip, padding[i]);
+            int style = rnd(4);
+            for (int y = 0; y < p.height; y++) {
+                for (int x = 0; x < p.width; x++) {
+                    if (c->config.sample_type == AR_SAMPLE_FLOAT) {
+                        p.f(x, y) = rnd(1 << 16) / 65535.0f;
+                        continue;
+                    }
+                    for (int b = 0; b < p.bpp; b++) {
+                        /* extremes find overflows, random data finds rounding errors. */
+                        p.at(x, y, b) = style == 0 ? 255 : style == 1 ? (rnd(2) ? 255 : 0) : (uint8_t)rnd();
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void alloc_output(const case_t& c, std::vector<plane_t>* dst, int frames)
+{
+    dst->resize(frames * c.num_plane);
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < c.num_plane; i++) {
+            plane_t& p = (*dst)[f * c.num_plane + i];
+            p.init(c.dst_w[i], c.dst_h[i], c.bpp(), rnd(8) == 0);
+            for (size_t k = 0; k < p.buff.size(); k++) {
+                p.buff[k] = 0xcd;
+            }
+        }
+    }
+}
+
+static void pointers(const std::vector<plane_t>& planes, const uint8_t** ptr, int* pitch, int count)
+{
+    for (int i = 0; i < count; i++) {
+        ptr[i] = planes[i].data;
+        pitch[i] = planes[i].pitch;
+    }
+}
+
+static void pointers(std::vector<plane_t>& planes, uint8_t** ptr, int* pitch, int count)
+{
+    for (int i = 0; i < count; i++) {
+        ptr[i] = planes[i].data;
+        pitch[i] = planes[i].pitch;
+    }
+}
+
+static bool same_plane(const plane_t& a, const plane_t& b)
+{
+    for (int y = 0; y < a.height; y++) {
+        if (memcmp(a.row(y), b.row(y), (size_t)a.width * a.bpp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char* format_name(int format)
+{
+    static const char* names[] = {"gray", "yuv", "rgbp", "rgb24", "rgb32", "nv12", "p010", "p016"};
+    return names[format];
+}
+
+static void describe(const case_t& c, char* buff, size_t size)
+{
+    const ar_config_t& cf = c.config;
+    snprintf(buff, size, "%s%s %d:%d->%d:%d %dx%d->%dx%d order %d%s%s", format_name(cf.format),
+             cf.alpha ? "+alpha" : "", cf.subsample_h, cf.subsample_v, cf.output_subsample_h,
+             cf.output_subsample_v, cf.src_width, cf.src_height, cf.target_width, cf.target_height,
+             cf.order, cf.sample_type == AR_SAMPLE_FLOAT ? " float" : "",
+             cf.premultiplied ? " premultiplied" : "");
+}
+
+/* the whole frame against the brute-force average. */
+static void check_reference(const case_t& c, const std::vector<plane_t>& dst, const ar_plan_t* plan, const char* name)
+{
+    for (int i = 0; i < c.num_plane; i++) {
+        const plane_t& s = c.src[i];
+        const plane_t& d = dst[i];
+        axis_ref_t h, v;
+        h.init(s.width, d.width);
+        v.init(s.height, d.height);
+        int64 total = (int64)s.width * s.height;
+        for (int y = 0; y < d.height; y++) {
+            for (int x = 0; x < d.width; x++) {
+                if (c.config.sample_type == AR_SAMPLE_FLOAT) {
+                    double e = area_average(s, h, v, x, y, -1);
+                    if (fabs(e - d.f(x, y)) > 1e-5) {
+                        CHECK(false, "%s: plane %d (%d, %d) is %f, expected %f", name, i, x, y, d.f(x, y), e);
+                        return;
+                    }
+                    continue;
+                }
+                for (int b = 0; b < d.bpp; b++) {
+                    int out = d.at(x, y, b);
+                    int64 expected = area_sum(s, h, v, x, y, b) / total;
+                    if (out != expected) {
+                        CHECK(false, "%s: plane %d (%d, %d) channel %d is %d, expected %lld", name, i, x, y, b,
+                              out, expected);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+    premultiplied RGB32: color is the alpha weighted average, sum(c * a * w)
+    / sum(a * w) in double, and must be within 0.5 of it; alpha is the
+    plain truncated average.
+*/
+static void check_premultiplied(const case_t& c, const std::vector<plane_t>& dst, const char* name)
+{
+    const plane_t& s = c.src[0];
+    const plane_t& d = dst[0];
+    if (s.width == d.width && s.height == d.height) {
+        /* nothing to average, the frame is copied. */
+        CHECK(same_plane(s, d), "%s: copy differs", name);
+        return;
+    }
+    axis_ref_t h, v;
+    h.init(s.width, d.width);
+    v.init(s.height, d.height);
+    int64 total = (int64)s.width * s.height;
+    for (int y = 0; y < d.height; y++) {
+        for (int x = 0; x < d.width; x++) {
+            int64 alpha = area_sum(s, h, v, x, y, 3);
+            int expected = (int)(alpha / total);
+            if (d.at(x, y, 3) != expected) {
+                CHECK(false, "%s: (%d, %d) alpha is %d, expected %d", name, x, y, d.at(x, y, 3), expected);
+                return;
+            }
+            for (int b = 0; b < 3; b++) {
+                double sum = 0.0;
+                for (int j = 0; j < v.count[y]; j++) {
+                    for (int i = 0; i < h.count[x]; i++) {
+                        int sx = h.first[x] + i, sy = v.first[y] + j;
+                        sum += (double)s.at(sx, sy, b) * s.at(sx, sy, 3) * h.weight[x][i] * v.weight[y][j];
+                    }
+                }
+                double e = alpha ? sum / alpha : 0.0;
+                if (fabs(d.at(x, y, b) - e) > 0.5 + 1e-9) {
+                    CHECK(false, "%s: (%d, %d) channel %d is %d, expected %f", name, x, y, b, d.at(x, y, b), e);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+/* regions, streams and batches must give the whole-frame output. */
+static void check_partial(const case_t& c, const ar_plan_t* plan, const std::vector<plane_t>& whole, const char* name)
+{
+    const uint8_t* src[AR_MAX_PLANES];
+    int src_pitch[AR_MAX_PLANES];
+    pointers(c.src, src, src_pitch, c.num_plane);
+
+    /* a few random rectangles per plane over a zeroed output. */
+    ar_scratch_t* scratch = ar_create_scratch(plan);
+    for (int i = 0; i < c.num_plane; i++) {
+        plane_t part;
+        part.init(c.dst_w[i], c.dst_h[i], c.bpp(), false);
+        for (int k = 0; k < 3; k++) {
+            int x = rnd(part.width), y = rnd(part.height);
+            int w = 1 + rnd(part.width - x), h = 1 + rnd(part.height - y);
+            std::vector<uint8_t> before(part.buff);
+            int ret = ar_resize_region(plan, scratch, i, src[i], src_pitch[i], part.data, part.pitch, x, y, w, h);
+            if (ret == AR_ERROR_UNSUPPORTED) {
+                break;
+            }
+            CHECK(ret == AR_OK, "%s: ar_resize_region() returned %d", name, ret);
+            for (int yy = 0; yy < part.height; yy++) {
+                for (int xx = 0; xx < part.width; xx++) {
+                    bool inside = xx >= x && xx < x + w && yy >= y && yy < y + h;
+                    const uint8_t* got = &part.at(xx, yy, 0);
+                    const uint8_t* want = inside ? &whole[i].at(xx, yy, 0)
+                                                 : &before[(size_t)yy * part.pitch + xx * part.bpp];
+                    if (memcmp(got, want, part.bpp)) {
+                        CHECK(false, "%s: region (%d, %d, %d, %d) of plane %d differs at (%d, %d)%s", name, x, y,
+                              w, h, i, xx, yy, inside ? "" : " outside");
+                        yy = part.height;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    ar_free_scratch(scratch);
+
+    /* the source in random bands. */
+    ar_stream_t* stream;
+    int ret = ar_create_stream(plan, &stream);
+    if (ret == AR_OK) {
+        std::vector<plane_t> out;
+        alloc_output(c, &out, 1);
+        uint8_t* dst[AR_MAX_PLANES];
+        int dst_pitch[AR_MAX_PLANES];
+        pointers(out, dst, dst_pitch, c.num_plane);
+        ar_begin_frame(stream, dst, dst_pitch, NULL, NULL);
+        int sub_v = c.config.subsample_v;
+        for (int y = 0; y < c.config.src_height;) {
+            int rows = (1 + rnd(7)) * sub_v;
+            if (y + rows > c.config.src_height) {
+                rows = c.config.src_height - y;
+            }
+            const uint8_t* band[AR_MAX_PLANES];
+            for (int i = 0; i < c.num_plane; i++) {
+                int plane_y = y * c.src_h[i] / c.config.src_height;
+                band[i] = c.src[i].row(plane_y);
+            }
+            ret = ar_push_rows(stream, band, src_pitch, rows);
+            CHECK(ret == AR_OK, "%s: ar_push_rows() returned %d", name, ret);
+            y += rows;
+        }
+        for (int i = 0; i < c.num_plane; i++) {
+            CHECK(same_plane(out[i], whole[i]), "%s: stream output of plane %d differs", name, i);
+        }
+        ar_free_stream(stream);
+    } else {
+        CHECK(ret == AR_ERROR_UNSUPPORTED, "%s: ar_create_stream() returned %d", name, ret);
+    }
+
+    /* the same frame several times in one batch. */
+    int count = 1 + rnd(3);
+    std::vector<const uint8_t*> srcs(count * c.num_plane);
+    for (int f = 0; f < count; f++) {
+        for (int i = 0; i < c.num_plane; i++) {
+            srcs[f * c.num_plane + i] = src[i];
+        }
+    }
+    std::vector<plane_t> out;
+    alloc_output(c, &out, count);
+    std::vector<uint8_t*> dsts(count * c.num_plane);
+    int dst_pitch[AR_MAX_PLANES];
+    for (int f = 0; f < count; f++) {
+        for (int i = 0; i < c.num_plane; i++) {
+            /* pitches are shared by the frames of a batch. */
+            out[f * c.num_plane + i] = out[i];
+            out[f * c.num_plane + i].data = &out[f * c.num_plane + i].buff[0] +
+                                            (out[i].data - &out[i].buff[0]);
+            dsts[f * c.num_plane + i] = out[f * c.num_plane + i].data;
+            dst_pitch[i] = out[i].pitch;
+        }
+    }
+    ret = ar_resize_batch(plan, NULL, count, &srcs[0], src_pitch, &dsts[0], dst_pitch);
+    CHECK(ret == AR_OK, "%s: ar_resize_batch() returned %d", name, ret);
+    for (int f = 0; f < count; f++) {
+        for (int i = 0; i < c.num_plane; i++) {
+            CHECK(same_plane(out[f * c.num_plane + i], whole[i]), "%s: batch frame %d plane %d differs", name, f, i);
+        }
+    }
+}
+
+/* exact, float and premultiplied plans of every format. */
+static void test_resize(int iterations)
+{
+    static const int formats[] = {AR_FORMAT_GRAY, AR_FORMAT_YUV, AR_FORMAT_RGBP, AR_FORMAT_RGB24, AR_FORMAT_RGB32};
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        int format = formats[rnd(5)];
+        int mode = rnd(5);  /* 0-2 exact, 3 float, 4 premultiplied */
+        make_case(&c, format, mode == 3, 48);
+        if (mode == 4 && format == AR_FORMAT_RGB32) {
+            c.config.premultiplied = 1;
+        }
+        fill_source(&c, 1);
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        int ret = ar_create_plan(&c.config, &plan);
+        CHECK(ret == AR_OK, "%s: ar_create_plan() returned %d", name, ret);
+        if (ret != AR_OK) {
+            continue;
+        }
+        CHECK(ar_plane_count(plan) == c.num_plane, "%s: %d planes", name, ar_plane_count(plan));
+        for (int i = 0; i < c.num_plane; i++) {
+            int w, h;
+            ar_plane_size(plan, i, &w, &h);
+            CHECK(w == c.dst_w[i] && h == c.dst_h[i], "%s: plane %d is %dx%d", name, i, w, h);
+        }
+
+        std::vector<plane_t> out;
+        alloc_output(c, &out, 1);
+        const uint8_t* src[AR_MAX_PLANES];
+        uint8_t* dst[AR_MAX_PLANES];
+        int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+        pointers(c.src, src, src_pitch, c.num_plane);
+        pointers(out, dst, dst_pitch, c.num_plane);
+        ret = ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        CHECK(ret == AR_OK, "%s: ar_resize() returned %d", name, ret);
+
+        if (c.config.premultiplied) {
+            check_premultiplied(c, out, name);
+        } else {
+            check_reference(c, out, plan, name);
+        }
+        check_partial(c, plan, out, name);
+        ar_free_plan(plan);
+    }
+}
+
+/*
+    premultiplied RGB32 at low alpha, where a color rounded to 8bit before
+    the divide is far off: 2:1 of (200, a = 3) and (0, a = 0) is 200.
+*/
+static void test_low_alpha(int iterations)
+{
+    uint8_t pixels[8] = {200, 200, 200, 3, 0, 0, 0, 0};
+    uint8_t out[4];
+    const uint8_t* src = pixels;
+    uint8_t* dst = out;
+    int src_pitch = 8, dst_pitch = 4;
+    ar_config_t config;
+    ar_init_config(&config, 2, 1, 1, 1, AR_FORMAT_RGB32, 1, 1);
+    config.premultiplied = 1;
+    ar_plan_t* plan;
+    if (ar_create_plan(&config, &plan) == AR_OK) {
+        ar_resize(plan, NULL, &src, &src_pitch, &dst, &dst_pitch);
+        CHECK(out[0] == 200 && out[1] == 200 && out[2] == 200 && out[3] == 1,
+              "premultiplied 2:1 is (%d, %d, %d, %d), expected (200, 200, 200, 1)", out[0], out[1], out[2], out[3]);
+        ar_free_plan(plan);
+    }
+
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        make_case(&c, AR_FORMAT_RGB32, false, 48);
+        c.config.premultiplied = 1;
+        fill_source(&c, 1);
+        plane_t& s = c.src[0];
+        for (int y = 0; y < s.height; y++) {
+            for (int x = 0; x < s.width; x++) {
+                s.at(x, y, 3) = (uint8_t)rnd(8);
+            }
+        }
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        if (ar_create_plan(&c.config, &plan) != AR_OK) {
+            CHECK(false, "%s: ar_create_plan() failed", name);
+            continue;
+        }
+        std::vector<plane_t> out;
+        alloc_output(c, &out, 1);
+        const uint8_t* src[AR_MAX_PLANES];
+        uint8_t* dst[AR_MAX_PLANES];
+        int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+        pointers(c.src, src, src_pitch, 1);
+        pointers(out, dst, dst_pitch, 1);
+        int ret = ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        CHECK(ret == AR_OK, "%s: ar_resize() returned %d", name, ret);
+        check_premultiplied(c, out, name);
+        ar_free_plan(plan);
+    }
+}
+
+/*
+    subsampled YUV with an alpha plane: the alpha plane of a stream band
+    has as many rows as luma, not as chroma.
+*/
+static void test_alpha(int iterations)
+{
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        do {
+            make_case(&c, AR_FORMAT_YUV, false, 32);
+        } while (c.config.subsample_v == 1);
+        c.config.alpha = 1;
+        c.num_plane = 4;
+        c.src_w[3] = c.config.src_width;
+        c.src_h[3] = c.config.src_height;
+        c.dst_w[3] = c.config.target_width;
+        c.dst_h[3] = c.config.target_height;
+        fill_source(&c, 1);
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        if (ar_create_plan(&c.config, &plan) != AR_OK) {
+            CHECK(false, "%s: ar_create_plan() failed", name);
+            continue;
+        }
+        std::vector<plane_t> out;
+        alloc_output(c, &out, 1);
+        const uint8_t* src[AR_MAX_PLANES];
+        uint8_t* dst[AR_MAX_PLANES];
+        int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+        pointers(c.src, src, src_pitch, c.num_plane);
+        pointers(out, dst, dst_pitch, c.num_plane);
+        ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        check_reference(c, out, plan, name);
+        check_partial(c, plan, out, name);
+        ar_free_plan(plan);
+    }
+}
+
+/* temporal averaging against the average over time and both axes. */
+static void test_temporal(int iterations)
+{
+    static const int formats[] = {AR_FORMAT_GRAY, AR_FORMAT_YUV, AR_FORMAT_RGBP, AR_FORMAT_RGB24, AR_FORMAT_RGB32};
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        make_case(&c, formats[rnd(5)], false, 16);
+        int num = 1 + rnd(5), den = num + rnd(7);
+        int frames = 1 + rnd(10);
+        fill_source(&c, frames);
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        ar_temporal_t* temporal;
+        if (ar_create_plan(&c.config, &plan) != AR_OK) {
+            CHECK(false, "%s: ar_create_plan() failed", name);
+            continue;
+        }
+        int ret = ar_create_temporal(plan, num, den, &temporal);
+        CHECK(ret == AR_OK, "%s: ar_create_temporal(%d, %d) returned %d", name, num, den, ret);
+        if (ret != AR_OK) {
+            ar_free_plan(plan);
+            continue;
+        }
+        std::vector<const uint8_t*> src(frames * c.num_plane);
+        int src_pitch[AR_MAX_PLANES];
+        for (int k = 0; k < frames * c.num_plane; k++) {
+            src[k] = c.src[k].data;
+            src_pitch[k % c.num_plane] = c.src[k].pitch;
+        }
+
+        int outputs = ar_temporal_frames(temporal, frames);
+        for (int n = 0; n < outputs; n++) {
+            int first, count;
+            ar_temporal_sources(temporal, n, &first, &count);
+            CHECK(first >= 0 && first + count <= frames, "%s: output %d reads frames %d+%d of %d", name, n, first,
+                  count, frames);
+            if (first < 0 || first + count > frames) {
+                break;
+            }
+            std::vector<plane_t> out;
+            alloc_output(c, &out, 1);
+            uint8_t* dst[AR_MAX_PLANES];
+            int dst_pitch[AR_MAX_PLANES];
+            pointers(out, dst, dst_pitch, c.num_plane);
+            ret = ar_resize_temporal(temporal, n, &src[first * c.num_plane], src_pitch, dst, dst_pitch);
+            CHECK(ret == AR_OK, "%s: ar_resize_temporal() returned %d", name, ret);
+
+            bool ok = true;
+            for (int i = 0; i < c.num_plane && ok; i++) {
+                const plane_t& d = out[i];
+                axis_ref_t h, v;
+                h.init(c.src_w[i], d.width);
+                v.init(c.src_h[i], d.height);
+                for (int y = 0; y < d.height && ok; y++) {
+                    for (int x = 0; x < d.width && ok; x++) {
+                        for (int b = 0; b < d.bpp && ok; b++) {
+                            int64 sum = 0, total = 0;
+                            for (int f = 0; f < frames; f++) {
+                                int64 w = overlap((int64)f * num, (int64)(f + 1) * num, (int64)n * den,
+                                                  (int64)(n + 1) * den);
+                                if (w) {
+                                    sum += area_sum(c.src[f * c.num_plane + i], h, v, x, y, b) * w;
+                                    total += w;
+                                }
+                            }
+                            int64 expected = sum / (total * c.src_w[i] * c.src_h[i]);
+                            ok = d.at(x, y, b) == expected;
+                            CHECK(ok, "%s: %d/%d output %d plane %d (%d, %d) is %d, expected %lld", name, num, den,
+                                  n, i, x, y, d.at(x, y, b), expected);
+                        }
+                    }
+                }
+            }
+        }
+        ar_free_temporal(temporal);
+        ar_free_plan(plan);
+    }
+}
+
+static float half_to_float(uint16_t h)
+{
+    int e = (h >> 10) & 31, m = h & 1023;
+    float v = e ? ldexpf((float)(m | 1024), e - 25) : ldexpf((float)m, -24);
+    return (h & 0x8000) ? -v : v;
+}
+
+/* float32/float16 tensors: average * scale + bias per channel, in the given channel order. */
+static void test_tensor(int iterations)
+{
+    static const int formats[] = {AR_FORMAT_GRAY, AR_FORMAT_RGBP, AR_FORMAT_RGB24, AR_FORMAT_RGB32};
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        make_case(&c, formats[rnd(4)], false, 40);
+        fill_source(&c, 1);
+        char name[160];
+        describe(c, name, sizeof(name));
+        int src_channels = c.num_plane > 1 ? c.num_plane : c.channels;
+
+        ar_tensor_t tensor;
+        ar_init_tensor(&tensor, rnd(2) ? AR_TENSOR_FLOAT16 : AR_TENSOR_FLOAT32);
+        tensor.channels = 1 + rnd(src_channels);
+        for (int k = 0; k < tensor.channels; k++) {
+            tensor.order[k] = rnd(src_channels);
+            tensor.scale[k] = (1 + rnd(100)) / (255.0f * 50);
+            tensor.bias[k] = (rnd(200) - 100) / 100.0f;
+        }
+
+        ar_plan_t* plan;
+        if (ar_create_plan(&c.config, &plan) != AR_OK) {
+            CHECK(false, "%s: ar_create_plan() failed", name);
+            continue;
+        }
+        int width = c.dst_w[0], height = c.dst_h[0];
+        size_t plane_size = (size_t)width * height;
+        size_t element = tensor.type == AR_TENSOR_FLOAT16 ? 2 : 4;
+        std::vector<uint8_t> out(plane_size * tensor.channels * element);
+        const uint8_t* src[AR_MAX_PLANES];
+        int src_pitch[AR_MAX_PLANES];
+        pointers(c.src, src, src_pitch, c.num_plane);
+        int ret = ar_resize_tensor(plan, NULL, &tensor, src, src_pitch, &out[0]);
+        CHECK(ret == AR_OK, "%s: ar_resize_tensor() returned %d", name, ret);
+
+        axis_ref_t h, v;
+        h.init(c.src_w[0], width);
+        v.init(c.src_h[0], height);
+        bool ok = ret == AR_OK;
+        for (int k = 0; k < tensor.channels && ok; k++) {
+            int order = tensor.order[k];
+            const plane_t& s = c.num_plane > 1 ? c.src[order] : c.src[0];
+            int b = c.num_plane > 1 ? 0 : order;
+            for (size_t p = 0; p < plane_size && ok; p++) {
+                int x = (int)(p % width), y = (int)(p / width);
+                double e = area_average(s, h, v, x, y, b) * tensor.scale[k] + tensor.bias[k];
+                size_t index = k * plane_size + p;
+                double got = element == 2 ? half_to_float(((uint16_t*)&out[0])[index]) : ((float*)&out[0])[index];
+                double tolerance = element == 2 ? 1e-3 * (fabs(e) + 1) : 1e-5 * (fabs(e) + 1);
+                ok = fabs(got - e) <= tolerance;
+                CHECK(ok, "%s: tensor channel %d (%d, %d) is %f, expected %f", name, k, x, y, got, e);
+            }
+        }
+        ar_free_plan(plan);
+    }
+}
+
+/* RGB24/RGB32 to planar YUV: within 1 of the converted average (chroma over its block). */
+static void test_to_yuv(int iterations)
+{
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        int format = rnd(2) ? AR_FORMAT_RGB24 : AR_FORMAT_RGB32;
+        make_case(&c, format, false, 40);
+        int s = rnd(6);
+        int sub_h = subsamples[s][0], sub_v = subsamples[s][1];
+        ar_config_t& cf = c.config;
+        cf.target_width -= cf.target_width % sub_h;
+        cf.target_height -= cf.target_height % sub_v;
+        if (cf.target_width < 1 || cf.target_height < 1 || cf.src_width < sub_h || cf.src_height < sub_v) {
+            continue;
+        }
+        if (cf.target_width == 0) {
+            continue;
+        }
+        cf.output_format = AR_FORMAT_YUV;
+        cf.output_subsample_h = sub_h;
+        cf.output_subsample_v = sub_v;
+        cf.matrix = rnd(2) ? AR_MATRIX_BT709 : AR_MATRIX_BT601;
+        cf.full_range = rnd(2);
+        fill_source(&c, 1);
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        int ret = ar_create_plan(&cf, &plan);
+        CHECK(ret == AR_OK, "%s: to yuv ar_create_plan() returned %d", name, ret);
+        if (ret != AR_OK) {
+            continue;
+        }
+        int tw = cf.target_width, th = cf.target_height;
+        std::vector<plane_t> out(3);
+        uint8_t* dst[3];
+        int dst_pitch[3];
+        for (int i = 0; i < 3; i++) {
+            out[i].init(i ? tw / sub_h : tw, i ? th / sub_v : th, 1, false);
+            dst[i] = out[i].data;
+            dst_pitch[i] = out[i].pitch;
+        }
+        const uint8_t* src[1] = {c.src[0].data};
+        int src_pitch[1] = {c.src[0].pitch};
+        ret = ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        CHECK(ret == AR_OK, "%s: to yuv ar_resize() returned %d", name, ret);
+
+        double kr = cf.matrix == AR_MATRIX_BT709 ? 0.2126 : 0.299;
+        double kb = cf.matrix == AR_MATRIX_BT709 ? 0.0722 : 0.114;
+        double kg = 1.0 - kr - kb;
+        double y_scale = cf.full_range ? 1.0 : 219.0 / 255.0, c_scale = cf.full_range ? 1.0 : 224.0 / 255.0;
+        bool ok = true;
+        for (int i = 0; i < 3 && ok; i++) {
+            const plane_t& d = out[i];
+            axis_ref_t h, v;
+            h.init(c.src_w[0], d.width);
+            v.init(c.src_h[0], d.height);
+            for (int y = 0; y < d.height && ok; y++) {
+                for (int x = 0; x < d.width && ok; x++) {
+                    double bgr[3];
+                    for (int b = 0; b < 3; b++) {
+                        bgr[b] = area_average(c.src[0], h, v, x, y, b);
+                    }
+                    double luma = kr * bgr[2] + kg * bgr[1] + kb * bgr[0];
+                    double e = i == 0 ? luma * y_scale + (cf.full_range ? 0 : 16)
+                             : i == 1 ? (bgr[0] - luma) / (2 * (1 - kb)) * c_scale + 128
+                                      : (bgr[2] - luma) / (2 * (1 - kr)) * c_scale + 128;
+                    e = e < 0 ? 0 : e > 255 ? 255 : e;
+                    ok = fabs(d.at(x, y, 0) - e) <= 1.0;
+                    CHECK(ok, "%s: to yuv 4:%d:%d plane %d (%d, %d) is %d, expected %f", name, sub_h, sub_v, i, x,
+                          y, d.at(x, y, 0), e);
+                }
+            }
+        }
+        ar_free_plan(plan);
+    }
+}
+
+/* NV12/P010/P016: luma as planar, UV interleaved, 16bit kept to depth bits and rounded. */
+static void test_semi_planar(int iterations)
+{
+    static const int formats[] = {AR_FORMAT_NV12, AR_FORMAT_P010, AR_FORMAT_P016};
+    for (int it = 0; it < iterations; it++) {
+        case_t c;
+        make_case(&c, AR_FORMAT_YUV, false, 40);
+        ar_config_t& cf = c.config;
+        cf.alpha = 0;
+        c.num_plane = 3;
+        cf.output_format = formats[rnd(3)];
+        fill_source(&c, 1);
+        char name[160];
+        describe(c, name, sizeof(name));
+
+        ar_plan_t* plan;
+        int ret = ar_create_plan(&cf, &plan);
+        CHECK(ret == AR_OK, "%s: %s ar_create_plan() returned %d", name, format_name(cf.output_format), ret);
+        if (ret != AR_OK) {
+            continue;
+        }
+        int depth = cf.output_format == AR_FORMAT_NV12 ? 8 : cf.output_format == AR_FORMAT_P010 ? 10 : 16;
+        int bytes = depth == 8 ? 1 : 2;
+        CHECK(ar_plane_count(plan) == 2, "%s: %d semi-planar planes", name, ar_plane_count(plan));
+        std::vector<plane_t> out(2);
+        uint8_t* dst[2];
+        int dst_pitch[2];
+        for (int i = 0; i < 2; i++) {
+            out[i].init(c.dst_w[i], c.dst_h[i], bytes * (i ? 2 : 1), rnd(4) == 0);
+            dst[i] = out[i].data;
+            dst_pitch[i] = out[i].pitch;
+        }
+        const uint8_t* src[3];
+        int src_pitch[3];
+        pointers(c.src, src, src_pitch, 3);
+        ret = ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        CHECK(ret == AR_OK, "%s: semi-planar ar_resize() returned %d", name, ret);
+
+        bool ok = true;
+        int64 max = (1 << depth) - 1;
+        for (int i = 0; i < 3 && ok; i++) {
+            const plane_t& d = out[i ? 1 : 0];
+            axis_ref_t h, v;
+            h.init(c.src_w[i], d.width);
+            v.init(c.src_h[i], d.height);
+            int64 total = (int64)c.src_w[i] * c.src_h[i];
+            for (int y = 0; y < d.height && ok; y++) {
+                for (int x = 0; x < d.width && ok; x++) {
+                    int64 sum = area_sum(c.src[i], h, v, x, y, 0);
+                    int sample = i ? (i - 1) : 0;
+                    int64 got, expected;
+                    if (depth == 8) {
+                        got = d.at(x, y, sample);
+                        expected = sum / total;
+                        ok = got == expected;
+                    } else {
+                        uint16_t word;
+                        memcpy(&word, &d.at(x, y, sample * 2), 2);
+                        got = word >> (16 - depth);
+                        /* round(sum / total * max / 255); a tie may go either way in floating point. */
+                        expected = (2 * sum * max + total * 255) / (2 * total * 255);
+                        ok = (word & ((1 << (16 - depth)) - 1)) == 0 && llabs(got - expected) <= 1;
+                    }
+                    CHECK(ok, "%s: %s plane %d (%d, %d) is %lld, expected %lld", name,
+                          format_name(cf.output_format), i, x, y, got, expected);
+                }
+            }
+        }
+        ar_free_plan(plan);
+    }
+}
+
+/*
+    one plan shared by several threads, the way the frontends use it:
+    each thread with its own scratch (AviSynth, the command line tool) or
+    none at all (VapourSynth's parallel GetFrame).
+*/
+static void test_threads(int frames_per_thread)
+{
+    static const int geometry[][5] = {
+        {AR_FORMAT_YUV, 1920, 1080, 854, 480},
+        {AR_FORMAT_RGB32, 1280, 720, 427, 241},
+        {AR_FORMAT_GRAY, 997, 601, 331, 199},
+    };
+    int threads = (int)std::thread::hardware_concurrency();
+    threads = threads < 4 ? 4 : threads > 16 ? 16 : threads;
+    for (int g = 0; g < 3; g++) {
+        case_t c;
+        make_case(&c, geometry[g][0], false, 8);
+        int sub = geometry[g][0] == AR_FORMAT_YUV ? 2 : 1;
+        ar_init_config(&c.config, geometry[g][1], geometry[g][2], geometry[g][3], geometry[g][4], geometry[g][0],
+                       sub, sub);
+        c.num_plane = geometry[g][0] == AR_FORMAT_YUV ? 3 : 1;
+        for (int i = 0; i < c.num_plane; i++) {
+            c.src_w[i] = i ? geometry[g][1] / sub : geometry[g][1];
+            c.src_h[i] = i ? geometry[g][2] / sub : geometry[g][2];
+            c.dst_w[i] = i ? geometry[g][3] / sub : geometry[g][3];
+            c.dst_h[i] = i ? geometry[g][4] / sub : geometry[g][4];
+        }
+        int frames = 4;
+        fill_source(&c, frames);
+        ar_plan_t* plan;
+        if (ar_create_plan(&c.config, &plan) != AR_OK) {
+            CHECK(false, "threads: ar_create_plan() failed");
+            continue;
+        }
+
+        std::vector<plane_t> expected;
+        alloc_output(c, &expected, frames);
+        for (int f = 0; f < frames; f++) {
+            const uint8_t* src[AR_MAX_PLANES];
+            uint8_t* dst[AR_MAX_PLANES];
+            int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+            for (int i = 0; i < c.num_plane; i++) {
+                src[i] = c.src[f * c.num_plane + i].data;
+                src_pitch[i] = c.src[f * c.num_plane + i].pitch;
+                dst[i] = expected[f * c.num_plane + i].data;
+                dst_pitch[i] = expected[f * c.num_plane + i].pitch;
+            }
+            ar_resize(plan, NULL, src, src_pitch, dst, dst_pitch);
+        }
+
+        std::vector<int> bad(threads, 0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.push_back(std::thread([&, t]() {
+                ar_scratch_t* scratch = t % 2 ? ar_create_scratch(plan) : NULL;
+                std::vector<plane_t> out;
+                alloc_output(c, &out, 1);
+                for (int k = 0; k < frames_per_thread; k++) {
+                    int f = (k + t) % frames;
+                    const uint8_t* src[AR_MAX_PLANES];
+                    uint8_t* dst[AR_MAX_PLANES];
+                    int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+                    for (int i = 0; i < c.num_plane; i++) {
+                        src[i] = c.src[f * c.num_plane + i].data;
+                        src_pitch[i] = c.src[f * c.num_plane + i].pitch;
+                    }
+                    pointers(out, dst, dst_pitch, c.num_plane);
+                    if (ar_resize(plan, scratch, src, src_pitch, dst, dst_pitch) != AR_OK) {
+                        bad[t]++;
+                    }
+                    for (int i = 0; i < c.num_plane; i++) {
+                        bad[t] += !same_plane(out[i], expected[f * c.num_plane + i]);
+                    }
+                }
+                ar_free_scratch(scratch);
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        for (int t = 0; t < threads; t++) {
+            CHECK(!bad[t], "threads: %s thread %d produced %d wrong planes", format_name(geometry[g][0]), t, bad[t]);
+        }
+        ar_free_plan(plan);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    if (argc > 2) {
+        rng_state = strtoull(argv[2], NULL, 0) | 1;
+    }
+
+    struct {
+        const char* name;
+        void (*func)(int);
+        int iterations;
+    } tests[] = {
+        {"resize/region/stream/batch", test_resize, iterations},
+        {"premultiplied low alpha", test_low_alpha, iterations / 8},
+        {"yuv + alpha", test_alpha, iterations / 8},
+        {"temporal", test_temporal, iterations / 8},
+        {"tensor", test_tensor, iterations / 4},
+        {"rgb to yuv", test_to_yuv, iterations / 4},
+        {"semi-planar", test_semi_planar, iterations / 4},
+        {"threads", test_threads, 24},
+    };
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        if (argc > 3 && strcmp(argv[3], tests[i].name)) {
+            continue;
+        }
+        int before = failures;
+        tests[i].func(tests[i].iterations);
+        printf("%-28s %s\n", tests[i].name, failures == before ? "ok" : "FAILED");
+    }
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,356 @@
+/*
+    AreaResize for VapourSynth
+
+    Copyright (C) 2012 Oka Motofumi(chikuzen.mo at gmail dot com)
+
+    author : Oka Motofumi
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include "VapourSynth.h"
+#include "arearesize.h"
+
+typedef struct {
+    VSNodeRef* node;
+    VSVideoInfo vi;
+    ar_plan_t* plan;
+    ar_thumbs_t* thumbs;
+    ar_cache_t* cache;
+    uint64_t source_id;
+    std::mutex* cache_lock;
+} area_resize_t;
+
+/*
+    frame properties are kept in the cache next to the pixels as records of
+    the key (with its terminating 0), the type, the element count and the
+    elements: int64, double, or uint32 size and bytes for data. returns
+    the size, or -1 when they do not fit or hold nodes, frames or
+    functions, which cannot be stored.
+*/
+static int pack_props(const VSMap* props, uint8_t* buff, const VSAPI* vsapi)
+{
+    int size = 0;
+    for (int k = 0, keys = vsapi->propNumKeys(props); k < keys; k++) {
+        const char* key = vsapi->propGetKey(props, k);
+        char type = vsapi->propGetType(props, key);
+        int count = vsapi->propNumElements(props, key);
+        int len = (int)strlen(key) + 1;
+        if ((type != ptInt && type != ptFloat && type != ptData) || size + len + 5 > AR_CACHE_META_SIZE) {
+            return -1;
+        }
+        memcpy(buff + size, key, len);
+        buff[size + len] = (uint8_t)type;
+        memcpy(buff + size + len + 1, &count, 4);
+        size += len + 5;
+        for (int i = 0; i < count; i++) {
+            int err;
+            if (type == ptData) {
+                int data_size = vsapi->propGetDataSize(props, key, i, &err);
+                if (size + 4 + data_size > AR_CACHE_META_SIZE) {
+                    return -1;
+                }
+                memcpy(buff + size, &data_size, 4);
+                memcpy(buff + size + 4, vsapi->propGetData(props, key, i, &err), data_size);
+                size += 4 + data_size;
+                continue;
+            }
+            if (size + 8 > AR_CACHE_META_SIZE) {
+                return -1;
+            }
+            if (type == ptInt) {
+                int64_t v = vsapi->propGetInt(props, key, i, &err);
+                memcpy(buff + size, &v, 8);
+            } else {
+                double v = vsapi->propGetFloat(props, key, i, &err);
+                memcpy(buff + size, &v, 8);
+            }
+            size += 8;
+        }
+    }
+    return size;
+}
+
+static void unpack_props(VSMap* props, const uint8_t* buff, int size, const VSAPI* vsapi)
+{
+    const uint8_t* end = buff + size;
+    while (buff < end) {
+        const char* key = (const char*)buff;
+        buff += strlen(key) + 1;
+        char type = (char)*buff;
+        int count;
+        memcpy(&count, buff + 1, 4);
+        buff += 5;
+        vsapi->propDeleteKey(props, key);
+        for (int i = 0; i < count; i++) {
+            if (type == ptData) {
+                int data_size;
+                memcpy(&data_size, buff, 4);
+                vsapi->propSetData(props, key, (const char*)buff + 4, data_size, paAppend);
+                buff += 4 + data_size;
+            } else if (type == ptInt) {
+                int64_t v;
+                memcpy(&v, buff, 8);
+                vsapi->propSetInt(props, key, v, paAppend);
+                buff += 8;
+            } else {
+                double v;
+                memcpy(&v, buff, 8);
+                vsapi->propSetFloat(props, key, v, paAppend);
+                buff += 8;
+            }
+        }
+    }
+}
+
+static void VS_CC
+vs_init(VSMap* in, VSMap* out, void** instance_data, VSNode* node, VSCore* core, const VSAPI* vsapi)
+{
+    area_resize_t* ar = (area_resize_t*)*instance_data;
+    vsapi->setVideoInfo(&ar->vi, 1, node);
+}
+
+/*
+    the filter is registered as fmParallel, so nothing in area_resize_t is
+    written here. passing no scratch to ar_resize() gives every request its
+    own intermediate buffers.
+*/
+static const VSFrameRef* VS_CC
+vs_get_frame(int n, int activation_reason, void** instance_data, void** frame_data,
+             VSFrameContext* frame_ctx, VSCore* core, const VSAPI* vsapi)
+{
+    area_resize_t* ar = (area_resize_t*)*instance_data;
+
+    if (activation_reason == arInitial) {
+        /* a cached frame does not even request the source, unless its thumbnail is missing. */
+        if (ar->cache && (!ar->thumbs || ar_thumb(ar->thumbs, n))) {
+            VSFrameRef* dst = vsapi->newVideoFrame(ar->vi.format, ar->vi.width, ar->vi.height, NULL, core);
+            uint8_t* dstp[AR_MAX_PLANES];
+            int dst_pitch[AR_MAX_PLANES];
+            for (int i = 0; i < ar->vi.format->numPlanes; i++) {
+                dstp[i] = vsapi->getWritePtr(dst, i);
+                dst_pitch[i] = vsapi->getStride(dst, i);
+            }
+            uint8_t meta[AR_CACHE_META_SIZE];
+            int meta_size;
+            std::lock_guard<std::mutex> lock(*ar->cache_lock);
+            if (ar_cache_get(ar->cache, ar->source_id, n, dstp, dst_pitch, meta, &meta_size)) {
+                unpack_props(vsapi->getFramePropsRW(dst), meta, meta_size, vsapi);
+                return dst;
+            }
+            vsapi->freeFrame(dst);
+        }
+        vsapi->requestFrameFilter(n, ar->node, frame_ctx);
+        return NULL;
+    }
+
+    if (activation_reason != arAllFramesReady) {
+        return NULL;
+    }
+
+    const VSFrameRef* src = vsapi->getFrameFilter(n, ar->node, frame_ctx);
+    VSFrameRef* dst = vsapi->newVideoFrame(ar->vi.format, ar->vi.width, ar->vi.height, src, core);
+
+    const uint8_t* srcp[AR_MAX_PLANES];
+    uint8_t* dstp[AR_MAX_PLANES];
+    int src_pitch[AR_MAX_PLANES], dst_pitch[AR_MAX_PLANES];
+    for (int i = 0; i < ar->vi.format->numPlanes; i++) {
+        srcp[i] = vsapi->getReadPtr(src, i);
+        src_pitch[i] = vsapi->getStride(src, i);
+        dstp[i] = vsapi->getWritePtr(dst, i);
+        dst_pitch[i] = vsapi->getStride(dst, i);
+    }
+
+    int ret = ar_resize(ar->plan, NULL, srcp, src_pitch, dstp, dst_pitch);
+    if (ret != AR_OK) {
+        vsapi->freeFrame(src);
+        vsapi->freeFrame(dst);
+        vsapi->setFilterError("AreaResize: out of memory", frame_ctx);
+        return NULL;
+    }
+
+    if (ar->cache) {
+        /* a frame whose properties cannot be stored is not cached, so a hit always has them. */
+        uint8_t meta[AR_CACHE_META_SIZE];
+        int meta_size = pack_props(vsapi->getFramePropsRO(dst), meta, vsapi);
+        if (meta_size >= 0) {
+            std::lock_guard<std::mutex> lock(*ar->cache_lock);
+            ar_cache_put(ar->cache, ar->source_id, n, (const uint8_t* const*)dstp, dst_pitch, meta, meta_size);
+        }
+    }
+    if (ar->thumbs && !ar_thumb(ar->thumbs, n)) {
+        /* from the source luma, so the thumbnail is rounded once. */
+        ar_write_thumb(ar->thumbs, n, srcp[0], src_pitch[0]);
+    }
+
+    vsapi->freeFrame(src);
+    return dst;
+}
+
+static void VS_CC
+vs_free(void* instance_data, VSCore* core, const VSAPI* vsapi)
+{
+    area_resize_t* ar = (area_resize_t*)instance_data;
+    vsapi->freeNode(ar->node);
+    ar_close_cache(ar->cache);
+    delete ar->cache_lock;
+    ar_close_thumbs(ar->thumbs);
+    ar_free_plan(ar->plan);
+    free(ar);
+}
+
+static void VS_CC
+create_area_resize(const VSMap* in, VSMap* out, void* user_data, VSCore* core, const VSAPI* vsapi)
+{
+    VSNodeRef* node = vsapi->propGetNode(in, "clip", 0, 0);
+    const VSVideoInfo* vi = vsapi->getVideoInfo(node);
+    int target_width = (int)vsapi->propGetInt(in, "width", 0, 0);
+    int target_height = (int)vsapi->propGetInt(in, "height", 0, 0);
+    int err;
+    int order = (int)vsapi->propGetInt(in, "order", 0, &err);
+    int autotune = (int)vsapi->propGetInt(in, "autotune", 0, &err);
+    const char* thumbs = vsapi->propGetData(in, "thumbs", 0, &err);
+    if (err) {
+        thumbs = NULL;
+    }
+    int thumbs_width = (int)vsapi->propGetInt(in, "thumbs_width", 0, &err);
+    if (err) {
+        thumbs_width = 64;
+    }
+    int thumbs_height = (int)vsapi->propGetInt(in, "thumbs_height", 0, &err);
+    if (err) {
+        thumbs_height = 36;
+    }
+    const char* cache = vsapi->propGetData(in, "cache", 0, &err);
+    if (err) {
+        cache = NULL;
+    }
+    int cache_size = (int)vsapi->propGetInt(in, "cache_size", 0, &err);
+    if (err) {
+        cache_size = 256;
+    }
+    const char* cache_key = vsapi->propGetData(in, "cache_key", 0, &err);
+    if (err) {
+        cache_key = NULL;
+    }
+
+    const char* msg = NULL;
+    if (!vi->format || vi->width == 0 || vi->height == 0) {
+        msg = "AreaResize: clip must have constant format and dimensions.";
+    } else if (!(vi->format->sampleType == stInteger && vi->format->bitsPerSample == 8) &&
+               !(vi->format->sampleType == stFloat && vi->format->bitsPerSample == 32)) {
+        msg = "AreaResize: only 8bit integer and 32bit float formats are supported.";
+    } else if (vi->format->colorFamily != cmGray && vi->format->colorFamily != cmYUV &&
+               vi->format->colorFamily != cmRGB) {
+        msg = "AreaResize: only Gray/YUV/RGB formats are supported.";
+    } else if (target_width < 1 || target_height < 1) {
+        msg = "AreaResize: target width/height must be 1 or higher.";
+    } else if (target_width & ((1 << vi->format->subSamplingW) - 1)) {
+        msg = "AreaResize: target width does not match chroma subsampling.";
+    } else if (target_height & ((1 << vi->format->subSamplingH) - 1)) {
+        msg = "AreaResize: target height does not match chroma subsampling.";
+    } else if (vi->width < target_width || vi->height < target_height) {
+        msg = "AreaResize: This filter is only for down scale.";
+    } else if (order < AR_ORDER_AUTO || order > AR_ORDER_VERTICAL_FIRST) {
+        msg = "AreaResize: order must be 0(auto), 1(horizontal first) or 2(vertical first).";
+    } else if (thumbs && (vi->format->colorFamily == cmRGB || vi->format->sampleType != stInteger)) {
+        msg = "AreaResize: thumbs requires an 8bit Gray or YUV clip.";
+    } else if (thumbs && (vi->numFrames < 1 || thumbs_width < 1 || thumbs_height < 1)) {
+        msg = "AreaResize: thumbs requires a known frame count and a size of 1 or higher.";
+    } else if (cache && cache_size < 1) {
+        msg = "AreaResize: cache_size must be 1 or higher.";
+    } else if (cache && (!cache_key || !*cache_key)) {
+        msg = "AreaResize: cache requires a cache_key that names the source.";
+    }
+    if (msg) {
+        vsapi->freeNode(node);
+        vsapi->setError(out, msg);
+        return;
+    }
+
+    area_resize_t* ar = (area_resize_t*)calloc(1, sizeof(area_resize_t));
+    if (!ar) {
+        vsapi->freeNode(node);
+        vsapi->setError(out, "AreaResize: out of memory");
+        return;
+    }
+
+    const VSFormat* format = vi->format;
+    int ar_format = format->colorFamily == cmGray ? AR_FORMAT_GRAY :
+                    format->colorFamily == cmRGB  ? AR_FORMAT_RGBP : AR_FORMAT_YUV;
+    ar_config_t config;
+    ar_init_config(&config, vi->width, vi->height, target_width, target_height, ar_format,
+                   1 << format->subSamplingW, 1 << format->subSamplingH);
+    if (format->sampleType == stFloat) {
+        config.sample_type = AR_SAMPLE_FLOAT;
+    }
+    config.order = order;
+    if (autotune) {
+        ar_autotune(&config, NULL);
+    }
+    int ret = ar_create_plan(&config, &ar->plan);
+    if (ret != AR_OK) {
+        vsapi->freeNode(node);
+        free(ar);
+        vsapi->setError(out, ret == AR_ERROR_NOMEM ? "AreaResize: out of memory" :
+                             "AreaResize: unsupported clip geometry.");
+        return;
+    }
+
+    if (thumbs) {
+        ret = ar_open_thumbs(thumbs, vi->numFrames, vi->width, vi->height,
+                             thumbs_width, thumbs_height, &ar->thumbs);
+        if (ret != AR_OK) {
+            vsapi->freeNode(node);
+            ar_free_plan(ar->plan);
+            free(ar);
+            vsapi->setError(out, ret == AR_ERROR_UNSUPPORTED ? "AreaResize: thumbnail larger than the source." :
+                                 "AreaResize: cannot open thumbs file.");
+            return;
+        }
+    }
+
+    if (cache) {
+        /* the source is identified by the caller's key and what the host tells about it. */
+        int64_t props[6] = {vi->width, vi->height, vi->numFrames, vi->fpsNum, vi->fpsDen, format->id};
+        ar->source_id = ar_hash64(cache_key, strlen(cache_key), ar_hash64(props, sizeof(props), 0));
+        ret = ar_open_cache(cache, ar->plan, (int64_t)cache_size << 20, &ar->cache);
+        if (ret != AR_OK) {
+            vsapi->freeNode(node);
+            ar_close_thumbs(ar->thumbs);
+            ar_free_plan(ar->plan);
+            free(ar);
+            vsapi->setError(out, "AreaResize: cannot open cache file.");
+            return;
+        }
+        ar->cache_lock = new std::mutex;
+    }
+
+    ar->node = node;
+    ar->vi = *vi;
+    ar->vi.width = target_width;
+    ar->vi.height = target_height;
+
+    vsapi->createFilter(in, out, "AreaResize", vs_init, vs_get_frame, vs_free, fmParallel, 0, ar, core);
+}
+
+VS_EXTERNAL_API(void)
+VapourSynthPluginInit(VSConfigPlugin config_func, VSRegisterFunction register_func, VSPlugin* plugin)
+{
+    config_func("chikuzen.mo.arearesize", "area",
+                "AreaResize for VapourSynth 0.2.0", VAPOURSYNTH_API_VERSION, 1, plugin);
+    register_func("AreaResize", "clip:clip;width:int;height:int;order:int:opt;autotune:int:opt;thumbs:data:opt;thumbs_width:int:opt;thumbs_height:int:opt;cache:data:opt;cache_size:int:opt;cache_key:data:opt;", create_area_resize, NULL, plugin);
+}